@@ -4,6 +4,8 @@
 #include "AI.hpp"
 #include "Engine.hpp"
 #include "Game.hpp"
+#include "Profiler.hpp"
+#include "Allocations.hpp"
 
 const int AI::Outputs = Genome::Output::OUT_MAX;
 
@@ -27,86 +29,166 @@ const float AI::EnableMutationChance = 0.2f;
 
 const int AI::MaxNodes = 1000000;
 
+const int AI::BackupCompression = 6;
+
+const char* MutationRates::rateNames[MutationRates::RATE_MAX] = {
+	"connections",
+	"link",
+	"bias",
+	"node",
+	"enable",
+	"disable",
+	"step"
+};
+
 void Gene::serialize(FileInterface* file) {
 	int version = 0;
 	file->property("version", version);
 	file->property("into", into);
 	file->property("out", out);
 	file->property("weight", weight);
-	file->property("innovation", innovation);
-	file->property("enabled", enabled);
+
+	// bitfields can't be bound to references
+	int innovationInt = innovation;
+	bool enabledBool = enabled;
+	file->property("innovation", innovationInt);
+	file->property("enabled", enabledBool);
+	innovation = innovationInt;
+	enabled = enabledBool;
+}
+
+MutationRates::MutationRates() {
+	rates[RATE_CONNECTIONS] = AI::MutateConnectionsChance;
+	rates[RATE_LINK] = AI::LinkMutationChance;
+	rates[RATE_BIAS] = AI::BiasMutationChance;
+	rates[RATE_NODE] = AI::NodeMutationChance;
+	rates[RATE_ENABLE] = AI::EnableMutationChance;
+	rates[RATE_DISABLE] = AI::DisableMutationChance;
+	rates[RATE_STEP] = AI::StepSize;
+}
+
+void MutationRates::serialize(FileInterface* file) {
+	// same layout as the Map these used to be stored in
+	Uint32 count = RATE_MAX;
+	file->propertyName("data");
+	file->beginArray(count);
+	for (Uint32 c = 0; c < count; ++c) {
+		String key;
+		float value = 0.f;
+		if (!file->isReading()) {
+			key = rateNames[c];
+			value = rates[c];
+		}
+
+		file->beginObject();
+		file->property("key", key);
+		file->property("value", value);
+		file->endObject();
+
+		if (file->isReading()) {
+			int rate = 0;
+			for (; rate < RATE_MAX; ++rate) {
+				if (key == rateNames[rate]) {
+					rates[rate] = value;
+					break;
+				}
+			}
+			if (rate == RATE_MAX) {
+				mainEngine->fmsg(Engine::MSG_WARN, "unknown mutation rate '%s'", key.get());
+			}
+		}
+	}
+	file->endArray();
 }
 
 Genome::Genome() {
-	mutationRates.insert("connections", AI::MutateConnectionsChance);
-	mutationRates.insert("link", AI::LinkMutationChance);
-	mutationRates.insert("bias", AI::BiasMutationChance);
-	mutationRates.insert("node", AI::NodeMutationChance);
-	mutationRates.insert("enable", AI::EnableMutationChance);
-	mutationRates.insert("disable", AI::DisableMutationChance);
-	mutationRates.insert("step", AI::StepSize);
 }
 
-Genome::Genome(const Genome& src) {
+Genome::Genome(Arena* arena) :
+	genes(arena)
+{
+}
+
+Genome::Genome(const Genome& src) :
+	genes(src.genes),
+	maxNeuron(src.maxNeuron),
+	mutationRates(src.mutationRates),
+	fitness(src.fitness),
+	globalRank(src.globalRank),
+	pool(src.pool)
+{
+}
+
+Genome::Genome(Genome&& src) :
+	genes(std::move(src.genes)),
+	maxNeuron(src.maxNeuron),
+	mutationRates(src.mutationRates),
+	fitness(src.fitness),
+	globalRank(src.globalRank),
+	pool(src.pool),
+	run(std::move(src.run))
+{
+}
+
+Genome::~Genome() {
+}
+
+Genome& Genome::operator=(const Genome& src) {
+	if (&src == this) {
+		return *this;
+	}
 	genes.copy(src.genes);
-	fitness = src.fitness;
-	network = src.network;
 	maxNeuron = src.maxNeuron;
+	mutationRates = src.mutationRates;
+	fitness = src.fitness;
 	globalRank = src.globalRank;
-	mutationRates.copy(src.mutationRates);
 	pool = src.pool;
-	framesSurvived = src.framesSurvived;
-	currentFrame = src.currentFrame;
-	game = src.game;
-	if (game) {
-		game->genome = this;
-	}
-	finished = src.finished;
-	totalDanger = src.totalDanger;
+	run.reset(); // no longer matches the genes
+	return *this;
 }
 
-Genome& Genome::operator=(const Genome& src) {
-	genes.copy(src.genes);
-	fitness = src.fitness;
-	network = src.network;
+Genome& Genome::operator=(Genome&& src) {
+	genes = std::move(src.genes);
 	maxNeuron = src.maxNeuron;
+	mutationRates = src.mutationRates;
+	fitness = src.fitness;
 	globalRank = src.globalRank;
-	mutationRates.copy(src.mutationRates);
 	pool = src.pool;
-	framesSurvived = src.framesSurvived;
-	currentFrame = src.currentFrame;
-	game = src.game;
-	if (game) {
-		game->genome = this;
-	}
-	finished = src.finished;
-	totalDanger = src.totalDanger;
+	run = std::move(src.run);
 	return *this;
 }
 
+bool Genome::isFinished() const {
+	return run && run->finished;
+}
+
+const std::shared_ptr<Game>& Genome::getGame() const {
+	static const std::shared_ptr<Game> none;
+	return run ? run->game : none;
+}
+
 void Genome::generateNetwork() {
+	assert(run);
+	Network& network = run->network;
+	Arena* arena = network.neurons.getArena();
 	network.neurons.clear();
+	network.neurons.reserve(pool->inputSize + AI::Outputs + genes.getSize() * 2);
 
 	for (int c = 0; c < pool->inputSize; ++c) {
-		network.neurons.insert(c, Neuron());
+		network.neurons.insert(c, Neuron(arena));
 	}
 
 	for (int c = 0; c < AI::Outputs; ++c) {
-		network.neurons.insert(AI::MaxNodes + c, Neuron());
+		network.neurons.insert(AI::MaxNodes + c, Neuron(arena));
 	}
 
 	genes.sort(Gene::AscSort());
 	for (int i = 0; i < genes.getSize(); ++i) {
 		auto& gene = genes[i];
 		if (gene.enabled) {
-			if (network.neurons[gene.out] == nullptr) {
-				network.neurons.insert(gene.out, Neuron());
-			}
-			Neuron& neuron = *network.neurons[gene.out];
+			Neuron& neuron = *network.neurons.emplace(gene.out, arena);
 			neuron.incoming.push(&gene);
-			if (network.neurons[gene.into] == nullptr) {
-				network.neurons.insert(gene.into, Neuron());
-			}
+			network.neurons.emplace(gene.into, arena);
 		}
 	}
 }
@@ -120,6 +202,8 @@ ArrayList<float> Genome::evaluateNetwork(ArrayList<float>& inputs) {
 		mainEngine->fmsg(Engine::MSG_WARN, "incorrect number of neural network inputs");
 		return ArrayList<float>();
 	}
+	assert(run);
+	Network& network = run->network;
 
 	for (int i = 0; i < pool->inputSize; ++i) {
 		Neuron* neuron = network.neurons[i];
@@ -156,7 +240,9 @@ ArrayList<float> Genome::evaluateNetwork(ArrayList<float>& inputs) {
 }
 
 int Genome::randomNeuron(bool nonInput) {
-	Map<int, bool> neurons;
+	Arena::Scope scope(pool->scratch);
+	Map<int, bool> neurons(&pool->scratch);
+	neurons.reserve(pool->inputSize + AI::Outputs + genes.getSize() * 2);
 
 	if (!nonInput) {
 		for (int i = 0; i < pool->inputSize; ++i) {
@@ -210,7 +296,7 @@ bool Genome::containsLink(const Gene& link) {
 }
 
 void Genome::pointMutate() {
-	auto step = *mutationRates["step"];
+	auto step = mutationRates[MutationRates::RATE_STEP];
 
 	for (int i = 0; i < genes.getSize(); ++i) {
 		auto& gene = genes[i];
@@ -266,15 +352,16 @@ void Genome::nodeMutate() {
 		return;
 	}
 	gene.enabled = false;
+	const Gene split = gene; // pushing below can reallocate genes
 
-	auto gene1 = gene;
+	auto gene1 = split;
 	gene1.out = maxNeuron;
 	gene1.weight = 1.f;
 	gene1.innovation = pool->newInnovation();
 	gene1.enabled = true;
 	genes.push(gene1);
 
-	auto gene2 = gene;
+	auto gene2 = split;
 	gene2.into = maxNeuron;
 	gene2.innovation = pool->newInnovation();
 	gene2.enabled = true;
@@ -298,20 +385,20 @@ void Genome::enableDisableMutate(bool enable) {
 }
 
 void Genome::mutate() {
-	for (auto& pair : mutationRates) {
+	for (auto& rate : mutationRates.rates) {
 		if (pool->rand.getUint32() % 2 == 0) {
-			pair.b *= 0.95f;
+			rate *= 0.95f;
 		} else {
-			pair.b *= 1.05263f;
+			rate *= 1.05263f;
 		}
 	}
 
-	if (pool->rand.getFloat() < *mutationRates["connections"]) {
+	if (pool->rand.getFloat() < mutationRates[MutationRates::RATE_CONNECTIONS]) {
 		pointMutate();
 	}
 
 	{
-		float p = *mutationRates["link"];
+		float p = mutationRates[MutationRates::RATE_LINK];
 		while (p > 0.f) {
 			if (pool->rand.getFloat() < p) {
 				linkMutate(false);
@@ -321,7 +408,7 @@ void Genome::mutate() {
 	}
 
 	{
-		float p = *mutationRates["bias"];
+		float p = mutationRates[MutationRates::RATE_BIAS];
 		while (p > 0.f) {
 			if (pool->rand.getFloat() < p) {
 				linkMutate(true);
@@ -331,7 +418,7 @@ void Genome::mutate() {
 	}
 
 	{
-		float p = *mutationRates["node"];
+		float p = mutationRates[MutationRates::RATE_NODE];
 		while (p > 0.f) {
 			if (pool->rand.getFloat() < p) {
 				nodeMutate();
@@ -341,7 +428,7 @@ void Genome::mutate() {
 	}
 
 	{
-		float p = *mutationRates["enable"];
+		float p = mutationRates[MutationRates::RATE_ENABLE];
 		while (p > 0.f) {
 			if (pool->rand.getFloat() < p) {
 				enableDisableMutate(true);
@@ -351,7 +438,7 @@ void Genome::mutate() {
 	}
 
 	{
-		float p = *mutationRates["disable"];
+		float p = mutationRates[MutationRates::RATE_DISABLE];
 		while (p > 0.f) {
 			if (pool->rand.getFloat() < p) {
 				enableDisableMutate(false);
@@ -381,10 +468,13 @@ Genome Species::crossover(Genome* g1, Genome* g2) {
 		g2 = temp;
 	}
 
-	Genome child;
+	Genome child(pool->getArena());
 	child.pool = pool;
+	child.genes.reserve(g1->genes.getSize());
 
-	Map<int, Gene*> innovations2;
+	Arena::Scope scope(pool->scratch);
+	Map<int, Gene*> innovations2(&pool->scratch);
+	innovations2.reserve(g2->genes.getSize());
 	for (int i = 0; i < g2->genes.getSize(); ++i) {
 		auto& gene = g2->genes[i];
 		innovations2.insert(gene.innovation, &gene);
@@ -402,11 +492,7 @@ Genome Species::crossover(Genome* g1, Genome* g2) {
 
 	child.maxNeuron = std::max(g1->maxNeuron, g2->maxNeuron);
 
-	for (auto& pair : g1->mutationRates) {
-		auto mutation = child.mutationRates[pair.a];
-		assert(mutation);
-		*mutation = pair.b;
-	}
+	child.mutationRates = g1->mutationRates;
 
 	return child;
 }
@@ -415,13 +501,16 @@ float Species::disjoint(Genome* g1, Genome* g2) {
 	assert(g1);
 	assert(g2);
 
-	Map<int, bool> i1;
+	Arena::Scope scope(pool->scratch);
+	Map<int, bool> i1(&pool->scratch);
+	i1.reserve(g1->genes.getSize());
 	for (int i = 0; i < g1->genes.getSize(); ++i) {
 		auto& gene = g1->genes[i];
 		i1.insert(gene.innovation, true);
 	}
 
-	Map<int, bool> i2;
+	Map<int, bool> i2(&pool->scratch);
+	i2.reserve(g2->genes.getSize());
 	for (int i = 0; i < g2->genes.getSize(); ++i) {
 		auto& gene = g2->genes[i];
 		i2.insert(gene.innovation, true);
@@ -451,7 +540,9 @@ float Species::weights(Genome* g1, Genome* g2) {
 	assert(g1);
 	assert(g2);
 
-	Map<int, Gene*> i2;
+	Arena::Scope scope(pool->scratch);
+	Map<int, Gene*> i2(&pool->scratch);
+	i2.reserve(g2->genes.getSize());
 	for (int i = 0; i < g2->genes.getSize(); ++i) {
 		auto& gene = g2->genes[i];
 		i2.insert(gene.innovation, &gene);
@@ -495,7 +586,7 @@ void Species::calculateAverageFitness() {
 }
 
 Genome Species::breedChild() {
-	Genome child;
+	Genome child(pool->getArena());
 	child.pool = pool;
 	if (genomes.getSize()) {
 		if (pool->rand.getFloat() < AI::CrossoverChance) {
@@ -529,11 +620,11 @@ Pool::Pool() {
 
 void Pool::init() {
 	for (int c = 0; c < AI::Population; ++c) {
-		Genome genome;
+		Genome genome(getArena());
 		genome.pool = this;
 		genome.maxNeuron = inputSize;
 		genome.mutate();
-		addToSpecies(genome);
+		addToSpecies(std::move(genome));
 	}
 }
 
@@ -598,7 +689,7 @@ void Pool::removeStaleSpecies() {
 			++spec.staleness;
 		}
 		if (spec.staleness < AI::StaleSpecies || spec.topFitness >= maxFitness) {
-			survived.push(spec);
+			survived.push(std::move(spec));
 		}
 	}
 	species.swap(survived);
@@ -611,18 +702,18 @@ void Pool::removeWeakSpecies() {
 		auto& spec = species[s];
 		int64_t breed = sum ? (int64_t)floorf(((float)spec.averageFitness / (float)sum) * (float)AI::Population) : 1;
 		if (breed >= 1) {
-			survived.push(spec);
+			survived.push(std::move(spec));
 		}
 	}
 	species.swap(survived);
 }
 
-void Pool::addToSpecies(Genome& child) {
+void Pool::addToSpecies(Genome&& child) {
 	bool foundSpecies = false;
 	for (int s = 0; s < species.getSize(); ++s) {
 		auto& spec = species[s];
 		if (spec.sameSpecies(&child, &spec.genomes[0])) {
-			spec.genomes.push(child);
+			spec.genomes.push(std::move(child));
 			foundSpecies = true;
 			break;
 		}
@@ -630,12 +721,13 @@ void Pool::addToSpecies(Genome& child) {
 	if (!foundSpecies) {
 		Species childSpecies;
 		childSpecies.pool = this;
-		childSpecies.genomes.push(child);
-		species.push(childSpecies);
+		childSpecies.genomes.push(std::move(child));
+		species.push(std::move(childSpecies));
 	}
 }
 
 void Pool::newGeneration() {
+	ALLOC_SCOPE(TAG_BREEDING);
 	cullSpecies(false); // cull the bottom half of each species
 	rankGlobally();
 	removeStaleSpecies();
@@ -646,7 +738,12 @@ void Pool::newGeneration() {
 	}
 	removeWeakSpecies();
 	int64_t sum = totalAverageFitness();
-	ArrayList<Genome> children;
+
+	// children are built in the other arena, while their parents are still in this one
+	const int parentArena = currentArena;
+	currentArena = 1 - currentArena;
+
+	ArrayList<Genome> children(getArena());
 	for (int s = 0; s < species.getSize(); ++s) {
 		auto& spec = species[s];
 		int64_t breed = (int64_t)floorf(((float)spec.averageFitness / (float)sum) * (float)AI::Population);
@@ -659,19 +756,31 @@ void Pool::newGeneration() {
 		auto& spec = species[rand.getUint32() % species.getSize()];
 		children.push(spec.breedChild());
 	}
+
+	// move the surviving parents out, then free the rest of their generation in one go
+	for (auto& spec : species) {
+		for (auto& genome : spec.genomes) {
+			genome.moveToArena(getArena());
+		}
+	}
+	arenas[parentArena].reset();
+
 	for (int c = 0; c < children.getSize(); ++c) {
-		auto& child = children[c];
-		addToSpecies(child);
+		addToSpecies(std::move(children[c]));
 	}
 
 	++generation;
 
-	StringBuf<32> buf("backup%d.json",generation);
-	writeFile(buf.get());
+	// json unless asked for binary, which is smaller and faster but tied to this build's struct layouts
+	StringBuf<32> buf(mainEngine->isBinaryBackups() ? "backup%d.bin" : "backup%d.json", generation);
+	writeFile(buf.get(), AI::BackupCompression);
 }
 
-void Pool::writeFile(const char* filename) {
-	FileHelper::writeObject(filename, EFileFormat::Json, *this);
+void Pool::writeFile(const char* filename, int compression) {
+	// .json files stay human readable, anything else is written in the smaller and faster binary format
+	const char* ext = strrchr(filename, '.');
+	EFileFormat format = (ext && strcmp(ext, ".json") == 0) ? EFileFormat::Json : EFileFormat::Binary;
+	FileHelper::writeObject(filename, format, *this, compression);
 }
 
 void Pool::savePool() {
@@ -684,7 +793,17 @@ void Pool::loadFile(const char* filename) {
 	innovation = AI::Outputs;
 	maxFitness = 0;
 	species.clear();
+	arenas[0].reset();
+	arenas[1].reset();
 	FileHelper::readObject(filename, *this);
+	if (species.getSize() == 0) {
+		mainEngine->fmsg(Engine::MSG_WARN, "no genomes loaded from '%s', starting a new pool", filename);
+		generation = 0;
+		maxFitness = 0;
+		arenas[0].reset();
+		arenas[1].reset();
+		init();
+	}
 }
 
 void Pool::loadPool() {
@@ -693,7 +812,7 @@ void Pool::loadPool() {
 }
 
 void Pool::serialize(FileInterface* file) {
-	int version = 0;
+	int version = 1;
 	file->property("version", version);
 	file->property("generation", generation);
 	int64_t maxFitnessInt = maxFitness.load();
@@ -708,6 +827,25 @@ void Pool::serialize(FileInterface* file) {
 			}
 		}
 	}
+
+	// genes refer to inputs by index, so a pool only makes sense with the sensors it was trained on.
+	// pools from before version 1 didn't save them, and keep whatever sensors.json set up
+	if (version >= 1) {
+		SensorSuite saved = sensors;
+		file->property("sensors", saved);
+		if (file->isReading()) {
+			if (!saved.isValid()) {
+				mainEngine->fmsg(Engine::MSG_ERROR, "pool was trained on sensors this build doesn't know, discarding it");
+				species.clear();
+			} else {
+				if (!saved.hasSameInputs(sensors)) {
+					mainEngine->fmsg(Engine::MSG_WARN, "pool was trained on different sensors than sensors.json, using the pool's");
+				}
+				sensors = saved;
+				inputSize = sensors.getInputSize();
+			}
+		}
+	}
 }
 
 AI::AI() {
@@ -728,89 +866,83 @@ void AI::init() {
 	pool = new Pool();
 	pool->ai = this;
 	pool->rand.seedTime();
-	pool->inputSize = 16;
+	if (!pool->sensors.load(mainEngine->buildPath("sensors.json").get())) {
+		mainEngine->fmsg(Engine::MSG_WARN, "using default sensors");
+	}
+	pool->inputSize = pool->sensors.getInputSize();
 	pool->init();
 	pool->writeFile("temp.json");
 }
 
-static const float aiClipNear = 10.f;
-static const float aiClipFar = 500.f;
-
 ArrayList<float> Genome::getInputs() {
 	ArrayList<float> inputs;
 	inputs.resize(pool->inputSize);
-	assert(game.get());
+	assert(run && run->game.get());
 
-	if (game->player) {
-		float angle = 0.f;
-		float finc = (PI * 2.f) / 16.f;
-		for (int c = 0; c < 16; ++c) {
-			auto& pos = game->player->pos;
-			auto& ang = game->player->ang;
-			auto result = game->player->rayTrace(pos, ang + angle);
-			if (result.a) {
-				//inputs[c * 2] = std::min(std::max((result.b - aiClipNear) / aiClipFar, 0.f), 1.f);
-				//inputs[c * 2] = 1.f / result.b;
-				inputs[c] = 1.f - std::min(std::max((result.b - aiClipNear) / aiClipFar, 0.f), 1.f);
-				//Vector towardsPlayer(cos(ang + angle + PI), sin(ang + angle + PI), 0.f);
-				//float redShift = result.a->vel.normal().dot(towardsPlayer);
-				//inputs[c * 2 + 1] = redShift;
-			} else {
-				inputs[c] = 0.f;
-				//inputs[c * 2] = 1.f;
-				//inputs[c * 2 + 1] = 0.f;
-			}
-			angle += finc;
-		}
-		/*if (inputs[0] != 0.f && !game->player->shooting) {
-			inputs[32] = 1.f;
-		} else {
-			inputs[32] = 0.f;
-		}*/
-		//inputs[32] = game->player->vel.x / 10.f;
-		//inputs[33] = game->player->vel.y / 10.f;
+	const Game& game = *run->game;
+	if (game.player) {
+		assert(run->sensors.getInputSize() == pool->inputSize);
+		run->sensors.sense(*game.player, inputs.getArray());
 	}
 
 	return inputs;
 }
 
 void Genome::clearJoypad() {
+	assert(run);
 	for (int c = 0; c < (int)Genome::Output::OUT_MAX; ++c) {
-		outputs[c] = 0.f;
+		run->outputs[c] = 0.f;
 	}
 }
 
 void Genome::initializeRun() {
-	game = std::make_shared<Game>(pool->ai, mainEngine->getXres(), mainEngine->getYres());
-	game->genome = this;
-	game->init();
-	framesSurvived = 0;
-	currentFrame = 0;
-	finished = false;
+	run.reset(new GenomeRun(pool->getArena()));
+	run->game = std::make_shared<Game>(pool->ai, mainEngine->getXres(), mainEngine->getYres());
+	run->game->genomeRun = run.get();
+	run->game->init();
+	run->actionRepeat = mainEngine->getActionRepeat();
+	run->sensors = pool->sensors;
 	clearJoypad();
 	generateNetwork();
 }
 
+void Genome::moveToArena(Arena* arena) {
+	genes = ArrayList<Gene>(genes, arena);
+	if (run) {
+		run->network.neurons.reset();
+	}
+}
+
 void Genome::evaluateCurrent() {
-	if (finished) {
+	PROFILE_THREAD("ai");
+	PROFILE_SCOPE("Genome::evaluateCurrent");
+	ALLOC_SCOPE(TAG_AI);
+	assert(run);
+	Game* game = run->game.get();
+	if (run->finished) {
 		clearJoypad();
 		return;
 	}
-	auto inputs = getInputs();
-	auto controller = evaluateNetwork(inputs);
 
-	if (controller.getSize()) {
-		if (controller[Genome::Output::OUT_LEFT] && controller[Genome::Output::OUT_RIGHT]) {
-			controller[Genome::Output::OUT_LEFT] = false;
-			controller[Genome::Output::OUT_RIGHT] = false;
-		}
-		for (int c = 0; c < (int)Genome::Output::OUT_MAX; ++c) {
-			outputs[c] = controller[c];
-		}
-	} else {
-		for (int c = 0; c < (int)Genome::Output::OUT_MAX; ++c) {
-			outputs[c] = 0.f;
+	// only sense and think every actionRepeat steps, holding the outputs in between
+	if (run->currentFrame % run->actionRepeat == 0) {
+		auto inputs = getInputs();
+		auto controller = evaluateNetwork(inputs);
+
+		if (controller.getSize()) {
+			if (controller[Genome::Output::OUT_LEFT] && controller[Genome::Output::OUT_RIGHT]) {
+				controller[Genome::Output::OUT_LEFT] = false;
+				controller[Genome::Output::OUT_RIGHT] = false;
+			}
+			for (int c = 0; c < (int)Genome::Output::OUT_MAX; ++c) {
+				run->outputs[c] = controller[c];
+			}
+		} else {
+			for (int c = 0; c < (int)Genome::Output::OUT_MAX; ++c) {
+				run->outputs[c] = 0.f;
+			}
 		}
+		run->heldDanger = run->sensors.getGreatestDanger(inputs.getArray());
 	}
 
 	game->process();
@@ -818,18 +950,15 @@ void Genome::evaluateCurrent() {
 	if (game->player) {
 		int shotsFired = game->player->shotsFired;
 		int shotsHit = game->player->shotsHit;
-		framesSurvived = std::max(framesSurvived, (int)game->player->ticks);
+		run->framesSurvived = std::max(run->framesSurvived, (int)game->player->ticks);
 
-		float greatestDanger = 0.f;
-		for (int c = 0; c < 16; ++c) {
-			greatestDanger = std::max(greatestDanger, inputs[c]);
-		}
-		totalDanger += 1.f - greatestDanger;
+		// framesSurvived counts ticks, so weigh each step by the ticks it covered
+		run->totalDanger += (1.f - run->heldDanger) * game->stepTicks;
 
 		fitness = game->score + 1;
 		//fitness *= avgDistance / (framesSurvived + 1);
-		fitness *= std::max(1.f, (float)framesSurvived);
-		float dangerRate = totalDanger / framesSurvived;
+		fitness *= std::max(1.f, (float)run->framesSurvived);
+		float dangerRate = run->totalDanger / run->framesSurvived;
 		fitness *= dangerRate * dangerRate;
 		//float hitRate = std::max((float)shotsHit, 1.f) / std::max((float)shotsFired, 1.f);
 		//fitness *= hitRate * hitRate;
@@ -843,10 +972,10 @@ void Genome::evaluateCurrent() {
 			pool->maxFitness = fitness;
 		}
 
-		finished = true;
+		run->finished = true;
 		game->term();
 	}
-	++currentFrame;
+	++run->currentFrame;
 }
 
 void AI::playTop() {
@@ -857,9 +986,9 @@ void AI::playTop() {
 		auto& spec = pool->species[s];
 		for (int g = 0; g < spec.genomes.getSize(); ++g) {
 			auto& genome = spec.genomes[g];
-			if (!focus || (genome.game && genome.fitness > maxFitness)) {
+			if (!focus || (genome.getGame() && genome.fitness > maxFitness)) {
 				maxFitness = genome.fitness;
-				focus = genome.game;
+				focus = genome.getGame();
 			}
 		}
 	}
@@ -871,7 +1000,7 @@ int AI::getMeasured() const {
 		auto& spec = pool->species[s];
 		for (int g = 0; g < spec.genomes.getSize(); ++g) {
 			auto& genome = spec.genomes[g];
-			if (genome.finished) {
+			if (genome.isFinished()) {
 				++done;
 			}
 			++count;
@@ -881,6 +1010,8 @@ int AI::getMeasured() const {
 }
 
 bool AI::process() {
+	PROFILE_SCOPE("AI::process");
+	ALLOC_SCOPE(TAG_AI);
 	int threads = 0;
 	bool result = true;
 
@@ -897,12 +1028,12 @@ bool AI::process() {
 
 	for (auto& spec : pool->species) {
 		for (auto& gen : spec.genomes) {
-			if (gen.game == nullptr) {
+			if (!gen.run) {
 				gen.initializeRun();
 			}
 			if (threads < 150) {
-				if (gen.finished) {
-					if (gen.game == focus) {
+				if (gen.isFinished()) {
+					if (gen.getGame() == focus) {
 						focus = nullptr;
 					}
 				} else {
@@ -911,19 +1042,20 @@ bool AI::process() {
 					++threads;
 				}
 			} else {
-				if (!gen.finished) {
+				if (!gen.isFinished()) {
 					result = false;
 				}
 			}
-			if (!gen.finished) {
-				if (!focus || !focus->gameInSession || (gen.game && gen.fitness > maxFitness)) {
+			if (!gen.isFinished()) {
+				if (!focus || !focus->gameInSession || (gen.getGame() && gen.fitness > maxFitness)) {
 					maxFitness = gen.fitness;
-					focus = gen.game;
+					focus = gen.getGame();
 				}
 			}
 		}
 	}
 
+	PROFILE_SCOPE("AI::process wait");
 	for (auto& task : tasks) {
 		task.wait();
 	}
@@ -939,7 +1071,25 @@ void AI::load() {
 	pool->loadPool();
 }
 
+void AI::countEntities(Uint32* counts) const {
+	for (auto& spec : pool->species) {
+		for (auto& gen : spec.genomes) {
+			const Game* game = gen.getGame().get();
+			if (!game || gen.isFinished()) {
+				continue;
+			}
+			for (int c = 0; c < (int)Entity::Type::TYPE_MAX; ++c) {
+				counts[c] += game->countType((Entity::Type)c);
+			}
+		}
+	}
+}
+
 void AI::nextGeneration() {
 	pool->rand.seedTime();
+	const int generation = pool->generation;
 	pool->newGeneration();
+
+	// breeding counts towards the generation it was bred from
+	Allocations::endGeneration(generation);
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "Random.hpp"
 #include "File.hpp"
 #include "Pair.hpp"
+#include "Sensor.hpp"
 
 #include <memory>
 #include <atomic>
@@ -19,7 +20,9 @@ class Game;
 class Neuron;
 class Network;
 class Gene;
+class MutationRates;
 class Genome;
+class GenomeRun;
 class Species;
 class Pool;
 class AI;
@@ -42,7 +45,8 @@ public:
 
 	void removeWeakSpecies();
 
-	void addToSpecies(Genome& child);
+	// @param child The genome to add, which is moved into a species
+	void addToSpecies(Genome&& child);
 
 	void newGeneration();
 
@@ -52,17 +56,29 @@ public:
 
 	void savePool();
 
-	void writeFile(const char* filename);
+	// @param filename the file to write, in json if it ends with .json and binary otherwise
+	// @param compression 0 for none, or a zlib level (1-9)
+	void writeFile(const char* filename, int compression = 0);
 
 	// save/load this object to a file
 	// @param file interface to serialize with
 	void serialize(FileInterface * file);
 
+	// @return the arena the current generation's genes and networks are stored in
+	Arena* getArena() { return &arenas[currentArena]; }
+
+	// generations are double-buffered, children are built in one arena while their parents are still in the other
+	// declared before the species, so they outlive every genome
+	Arena arenas[2];
+	int currentArena = 0;
+	Arena scratch; // temporary maps, rewound as soon as they are done with
+
 	int generation = 0;
 	int innovation;
 	std::atomic<int64_t> maxFitness { 0 };
 	ArrayList<Species> species;
 	int inputSize = 0;
+	SensorSuite sensors;
 	Random rand;
 
 	AI* ai = nullptr;
@@ -97,6 +113,10 @@ public:
 	// advance generation
 	void nextGeneration();
 
+	// add up the entities of each type in every game still running
+	// @param counts one count per Entity::Type, added to
+	void countEntities(Uint32* counts) const;
+
 	static const int Outputs;
 
 	static const int Population;
@@ -119,6 +139,9 @@ public:
 
 	static const int MaxNodes;
 
+	// zlib level the backup written every generation is compressed with (0 for none)
+	static const int BackupCompression;
+
 	std::shared_ptr<Game> focus { nullptr };
 
 private:
@@ -128,6 +151,8 @@ private:
 class Neuron {
 public:
 	Neuron() {}
+	Neuron(Arena* arena) :
+		incoming(arena) {}
 
 	ArrayList<Gene*> incoming;
 	float value = 0.f;
@@ -136,19 +161,18 @@ public:
 class Network {
 public:
 	Network() {}
+	Network(Arena* arena) :
+		neurons(arena) {}
 
 	Map<int, Neuron> neurons;
 };
 
+// a connection between two neurons, packed into 16 bytes
 class Gene {
 public:
-	Gene() {}
-	Gene(const Gene& src) :
-		into(src.into),
-		out(src.out),
-		weight(src.weight),
-		enabled(src.enabled),
-		innovation(src.innovation)
+	Gene() :
+		innovation(0),
+		enabled(1)
 	{}
 
 	// save/load this object to a file
@@ -158,8 +182,8 @@ public:
 	int into = 0;
 	int out = 0;
 	float weight = 0.f;
-	bool enabled = true;
-	int innovation = 0;
+	Uint32 innovation : 31;
+	Uint32 enabled : 1;
 
 	class AscSort : public ArrayList<Gene>::SortFunction {
 	public:
@@ -181,13 +205,53 @@ public:
 		}
 	};
 };
+static_assert(sizeof(Gene) == 16, "Gene should pack into 16 bytes");
+
+// gene lists are copied into binary files whole (the json format still goes through Gene::serialize)
+template<> struct IsRawSerializable<Gene> : std::true_type {};
+static_assert(std::is_trivially_copyable<Gene>::value, "Gene is copied as raw bytes");
+
+// the chances of each kind of mutation, which are mutated along with the genome
+class MutationRates {
+public:
+	MutationRates();
+
+	enum Rate {
+		RATE_CONNECTIONS,
+		RATE_LINK,
+		RATE_BIAS,
+		RATE_NODE,
+		RATE_ENABLE,
+		RATE_DISABLE,
+		RATE_STEP,
+		RATE_MAX
+	};
+
+	// names of the rates in saved pools
+	static const char* rateNames[RATE_MAX];
+
+	float& operator[](Rate rate) { return rates[rate]; }
+	const float& operator[](Rate rate) const { return rates[rate]; }
 
+	// save/load this object to a file
+	// @param file interface to serialize with
+	void serialize(FileInterface * file);
+
+	float rates[RATE_MAX];
+};
+
+// the heritable part of a network: its genes and mutation rates
+// copying a genome copies only that (and its scores), never the state of a run
 class Genome {
 public:
 	Genome();
+	Genome(Arena* arena);
 	Genome(const Genome& src);
+	Genome(Genome&& src);
+	~Genome();
 
 	Genome& operator=(const Genome& src);
+	Genome& operator=(Genome&& src);
 
 	void mutate();
 
@@ -209,30 +273,36 @@ public:
 
 	void initializeRun();
 
+	// move the genes into another arena, and drop the network built from them
+	// @param arena the arena to move to
+	void moveToArena(Arena* arena);
+
 	void clearJoypad();
 
 	void evaluateCurrent();
 
 	ArrayList<float> getInputs();
 
+	// @return true if the genome's fitness has been fully measured
+	bool isFinished() const;
+
+	// @return the game the genome is being measured in, if any
+	const std::shared_ptr<Game>& getGame() const;
+
 	// save/load this object to a file
 	// @param file interface to serialize with
 	void serialize(FileInterface * file);
 
 	ArrayList<Gene> genes;
-	int64_t fitness = 0;
-	Network network;
 	int maxNeuron = 0;
+	MutationRates mutationRates;
+	int64_t fitness = 0;
 	int globalRank = 0;
-	Map<String, float> mutationRates;
 
 	Pool* pool = nullptr;
 
-	int framesSurvived = 0;
-	Uint32 currentFrame = 0;
-	std::shared_ptr<Game> game { nullptr };
-	bool finished = false;
-	float totalDanger = 0.f;
+	// created by initializeRun(), and only ever moved (not copied) with the genome
+	std::unique_ptr<GenomeRun> run;
 
 	// controller outputs
 	enum Output {
@@ -242,7 +312,6 @@ public:
 		//OUT_SHOOT,
 		OUT_MAX
 	};
-	float outputs[Output::OUT_MAX];
 
 	class AscSortPtr : public ArrayList<Genome*>::SortFunction {
 	public:
@@ -268,6 +337,25 @@ private:
 	static float sigmoid(float x);
 };
 
+// everything about a genome that only matters while its fitness is measured
+// kept at a stable address, so the game can refer to it while the genome moves around
+class GenomeRun {
+public:
+	GenomeRun(Arena* arena) :
+		network(arena) {}
+
+	Network network;
+	std::shared_ptr<Game> game { nullptr };
+	int framesSurvived = 0;
+	Uint32 currentFrame = 0;
+	bool finished = false;
+	float totalDanger = 0.f;
+	float heldDanger = 0.f; // danger sensed at the last decision
+	Uint32 actionRepeat = 1; // steps to hold each decision for, sensors and network are skipped in between
+	SensorSuite sensors; // scratch for getInputs(), copied from the pool for each run
+	float outputs[Genome::Output::OUT_MAX];
+};
+
 class Species {
 public:
 	Species() {}
@@ -0,0 +1,378 @@
+// Allocations.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Allocations.hpp"
+#include "Counters.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+FILE* Allocations::csvFile = nullptr;
+Allocations::Report Allocations::frameReport;
+
+static const char* tagNames[Allocations::TAG_MAX] = {
+	"other",
+	"game",
+	"ai",
+	"breeding",
+	"render",
+	"io"
+};
+
+// totals for one tag, since the program started
+struct AllocationTotals {
+	Uint64 allocations = 0;
+	Uint64 frees = 0;
+	Uint64 bytes = 0;
+	Uint64 freedBytes = 0;
+};
+
+// one thread's totals for each tag. only the owning thread writes them, so counting is a plain load and store
+// on memory no other thread is writing to. reports add them up under allocationLock.
+// trivially destructible, so it stays usable while the thread's other destructors free things
+struct ThreadAllocations {
+	struct Tag {
+		std::atomic<Uint64> allocations;
+		std::atomic<Uint64> frees;
+		std::atomic<Uint64> bytes;
+		std::atomic<Uint64> freedBytes;
+	};
+	Tag tags[Allocations::TAG_MAX];
+	ThreadAllocations* next;	// in the list of running threads
+	bool linked;				// true while in the list
+	bool retired;				// true once the thread is exiting, after which it counts straight into retiredTotals
+};
+
+// everything below is shared between threads, and guarded by this
+static std::mutex allocationLock;
+static ThreadAllocations* runningThreads = nullptr;
+static AllocationTotals retiredTotals[Allocations::TAG_MAX]; // from threads that have exited
+
+// totals as of the end of the last frame, and of the last generation (only touched by the thread that ends them)
+static Allocations::Report lastFrame;
+static Allocations::Report lastGeneration;
+static Uint64 generationPeak[Allocations::TAG_MAX + 1] = { 0 };
+static Uint32 frameNumber = 0;
+
+// fill a report with what happened since a previous one
+// threads don't share a live total, so peaks are only sampled when frames end
+// @param report the report to fill
+// @param last the totals when the period began, updated to the totals now
+// @param generation true to take the peak since the last generation, false for the peak between frame ends
+static void takeReport(Allocations::Report& report, Allocations::Report& last, bool generation) {
+	AllocationTotals totals[Allocations::TAG_MAX + 1];
+	{
+		std::lock_guard<std::mutex> lock(allocationLock);
+		for( int c = 0; c < Allocations::TAG_MAX; ++c ) {
+			totals[c] = retiredTotals[c];
+		}
+		for( ThreadAllocations* thread = runningThreads; thread != nullptr; thread = thread->next ) {
+			for( int c = 0; c < Allocations::TAG_MAX; ++c ) {
+				const ThreadAllocations::Tag& src = thread->tags[c];
+				totals[c].allocations += src.allocations.load(std::memory_order_relaxed);
+				totals[c].frees += src.frees.load(std::memory_order_relaxed);
+				totals[c].bytes += src.bytes.load(std::memory_order_relaxed);
+				totals[c].freedBytes += src.freedBytes.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	AllocationTotals& all = totals[Allocations::TAG_MAX];
+	for( int c = 0; c < Allocations::TAG_MAX; ++c ) {
+		all.allocations += totals[c].allocations;
+		all.frees += totals[c].frees;
+		all.bytes += totals[c].bytes;
+		all.freedBytes += totals[c].freedBytes;
+	}
+
+	for( int c = 0; c <= Allocations::TAG_MAX; ++c ) {
+		const AllocationTotals& src = totals[c];
+		Allocations::Stats& stats = c < Allocations::TAG_MAX ? report.tags[c] : report.total;
+		Allocations::Stats& prev = c < Allocations::TAG_MAX ? last.tags[c] : last.total;
+
+		// threads are read one after another, so a free can be seen before the allocation it undoes
+		const Uint64 live = src.bytes > src.freedBytes ? src.bytes - src.freedBytes : 0;
+
+		stats.allocations = src.allocations - prev.allocations;
+		stats.frees = src.frees - prev.frees;
+		stats.bytes = src.bytes - prev.bytes;
+		stats.liveBytes = live;
+		generationPeak[c] = std::max(generationPeak[c], live);
+		if( generation ) {
+			stats.peakBytes = generationPeak[c];
+			generationPeak[c] = live;
+		} else {
+			stats.peakBytes = std::max(prev.liveBytes, live);
+		}
+
+		prev.allocations = src.allocations;
+		prev.frees = src.frees;
+		prev.bytes = src.bytes;
+		prev.liveBytes = live;
+	}
+}
+
+const char* Allocations::getTagName(Tag tag) {
+	assert(tag >= 0 && tag < TAG_MAX);
+	return tagNames[tag];
+}
+
+bool Allocations::startRecording(const char* filename) {
+	stopRecording();
+	if( fopen_s(&csvFile, filename, "wb") || !csvFile ) {
+		csvFile = nullptr;
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to open '%s' to record allocations", filename);
+		return false;
+	}
+
+	fprintf(csvFile, "frame");
+	for( int c = 0; c <= TAG_MAX; ++c ) {
+		const char* name = c < TAG_MAX ? tagNames[c] : "total";
+		fprintf(csvFile, ",%s allocations,%s frees,%s bytes,%s live bytes,%s peak bytes", name, name, name, name, name);
+	}
+	fprintf(csvFile, "\n");
+	mainEngine->fmsg(Engine::MSG_INFO, "recording allocations to '%s'", filename);
+	return true;
+}
+
+void Allocations::stopRecording() {
+	if( csvFile ) {
+		fclose(csvFile);
+		csvFile = nullptr;
+		mainEngine->fmsg(Engine::MSG_INFO, "stopped recording allocations");
+	}
+}
+
+void Allocations::endFrame() {
+	takeReport(frameReport, lastFrame, false);
+	Counters::set(Counters::HEAP_ALLOCATIONS, (Uint32)frameReport.total.allocations);
+	++frameNumber;
+
+	if( csvFile ) {
+		fprintf(csvFile, "%u", frameNumber);
+		for( int c = 0; c <= TAG_MAX; ++c ) {
+			const Stats& stats = c < TAG_MAX ? frameReport.tags[c] : frameReport.total;
+			fprintf(csvFile, ",%llu,%llu,%llu,%llu,%llu",
+				(unsigned long long)stats.allocations, (unsigned long long)stats.frees, (unsigned long long)stats.bytes,
+				(unsigned long long)stats.liveBytes, (unsigned long long)stats.peakBytes);
+		}
+		fprintf(csvFile, "\n");
+	}
+}
+
+void Allocations::endGeneration(int generation) {
+#ifndef NO_ALLOC_TRACKING
+	Report report;
+	takeReport(report, lastGeneration, true);
+
+	auto log = [generation](const char* name, const Stats& stats) {
+		mainEngine->fmsg(Engine::MSG_INFO, "generation %d %s allocations: %llu (%llu freed), %.2f MB, %.2f MB live, %.2f MB peak",
+			generation, name, (unsigned long long)stats.allocations, (unsigned long long)stats.frees,
+			stats.bytes / 1048576.0, stats.liveBytes / 1048576.0, stats.peakBytes / 1048576.0);
+	};
+	for( int c = 0; c < TAG_MAX; ++c ) {
+		if( report.tags[c].allocations || report.tags[c].frees ) {
+			log(tagNames[c], report.tags[c]);
+		}
+	}
+	log("total", report.total);
+#endif
+}
+
+#ifndef NO_ALLOC_TRACKING
+
+// the tag of the calling thread's allocations
+static thread_local Allocations::Tag currentTag = Allocations::TAG_OTHER;
+
+Allocations::Tag Allocations::getTag() {
+	return currentTag;
+}
+
+void Allocations::setTag(Tag tag) {
+	assert(tag >= 0 && tag < TAG_MAX);
+	currentTag = tag;
+}
+
+// sits in front of every tracked block, keeping the block as aligned as malloc left it
+union AllocationHeader {
+	struct {
+		size_t size;
+		Allocations::Tag tag;
+	} info;
+	std::max_align_t align;
+};
+
+// the calling thread's totals
+static thread_local ThreadAllocations threadAllocations;
+
+// @param value a counter only the calling thread writes to
+// @param amount how much to add to it
+static void bump(std::atomic<Uint64>& value, Uint64 amount) {
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// moves an exiting thread's totals into retiredTotals
+struct ThreadExit {
+	~ThreadExit() {
+		ThreadAllocations& local = threadAllocations;
+		std::lock_guard<std::mutex> lock(allocationLock);
+		for( ThreadAllocations** link = &runningThreads; *link != nullptr; link = &(*link)->next ) {
+			if( *link == &local ) {
+				*link = local.next;
+				break;
+			}
+		}
+		for( int c = 0; c < Allocations::TAG_MAX; ++c ) {
+			const ThreadAllocations::Tag& src = local.tags[c];
+			retiredTotals[c].allocations += src.allocations.load(std::memory_order_relaxed);
+			retiredTotals[c].frees += src.frees.load(std::memory_order_relaxed);
+			retiredTotals[c].bytes += src.bytes.load(std::memory_order_relaxed);
+			retiredTotals[c].freedBytes += src.freedBytes.load(std::memory_order_relaxed);
+		}
+		local.linked = false;
+		local.retired = true;
+	}
+};
+static thread_local ThreadExit threadExit;
+
+// @return the calling thread's totals, or nullptr if the thread is exiting
+static ThreadAllocations* localAllocations() {
+	ThreadAllocations& local = threadAllocations;
+	if( !local.linked ) {
+		if( local.retired ) {
+			return nullptr;
+		}
+		(void)&threadExit; // constructed on first use, so it only runs for threads that counted something
+		std::lock_guard<std::mutex> lock(allocationLock);
+		local.next = runningThreads;
+		runningThreads = &local;
+		local.linked = true;
+	}
+	return &local;
+}
+
+// @param size the size of a block that was just allocated, not counting its header
+// @param tag the tag it was allocated under
+static void countAllocation(size_t size, Allocations::Tag tag) {
+	if( ThreadAllocations* local = localAllocations() ) {
+		bump(local->tags[tag].allocations, 1);
+		bump(local->tags[tag].bytes, size);
+	} else {
+		std::lock_guard<std::mutex> lock(allocationLock);
+		++retiredTotals[tag].allocations;
+		retiredTotals[tag].bytes += size;
+	}
+}
+
+// @param header the header of a block that is about to be freed
+static void countFree(const AllocationHeader* header) {
+	const Allocations::Tag tag = header->info.tag;
+	if( ThreadAllocations* local = localAllocations() ) {
+		bump(local->tags[tag].frees, 1);
+		bump(local->tags[tag].freedBytes, header->info.size);
+	} else {
+		std::lock_guard<std::mutex> lock(allocationLock);
+		++retiredTotals[tag].frees;
+		retiredTotals[tag].freedBytes += header->info.size;
+	}
+}
+
+void* Allocations::allocate(size_t size) {
+	AllocationHeader* header = (AllocationHeader*)malloc(sizeof(AllocationHeader) + size);
+	if( !header ) {
+		return nullptr;
+	}
+	header->info.size = size;
+	header->info.tag = currentTag;
+	countAllocation(size, currentTag);
+	return header + 1;
+}
+
+void* Allocations::reallocate(void* ptr, size_t size) {
+	if( !ptr ) {
+		return allocate(size);
+	}
+
+	// counted as freeing the old block and allocating a new one
+	AllocationHeader* header = (AllocationHeader*)ptr - 1;
+	const AllocationHeader old = *header;
+	header = (AllocationHeader*)realloc(header, sizeof(AllocationHeader) + size);
+	if( !header ) {
+		return nullptr;
+	}
+	countFree(&old);
+	header->info.size = size;
+	header->info.tag = currentTag;
+	countAllocation(size, currentTag);
+	return header + 1;
+}
+
+void Allocations::release(void* ptr) {
+	if( !ptr ) {
+		return;
+	}
+	AllocationHeader* header = (AllocationHeader*)ptr - 1;
+	countFree(header);
+	free(header);
+}
+
+// every new and delete goes through the tracker
+void* operator new(size_t size) {
+	if( size == 0 ) {
+		size = 1;
+	}
+	for( ;; ) {
+		if( void* ptr = Allocations::allocate(size) ) {
+			return ptr;
+		}
+		std::new_handler handler = std::get_new_handler();
+		if( !handler ) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	} catch( ... ) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept {
+	Allocations::release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	Allocations::release(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	Allocations::release(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	Allocations::release(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+	Allocations::release(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+	Allocations::release(ptr);
+}
+
+#endif
@@ -0,0 +1,114 @@
+// Allocations.hpp
+// Tracks heap allocations, attributed to whatever the allocating thread was doing
+
+#pragma once
+
+#include "Main.hpp"
+
+// ALLOC_SCOPE(tag) attributes the allocations made in the rest of the enclosing block to a tag.
+// the innermost scope on a thread wins, and allocations outside of any scope are tagged TAG_OTHER.
+// every operator new and delete is hooked, along with the malloc/realloc/free calls that go through
+// Allocations::allocate/reallocate/release. define NO_ALLOC_TRACKING to compile all of it out
+#ifndef NO_ALLOC_TRACKING
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+#define ALLOC_SCOPE(tag) Allocations::Scope ALLOC_CONCAT(allocScope, __LINE__)(Allocations::tag)
+#else
+#define ALLOC_SCOPE(tag) ((void)0)
+#endif
+
+// each block carries a small header with its size and tag, so frees are attributed to where the block came from.
+// each thread keeps its own totals, which reports add up and compare between the ends of frames or generations
+class Allocations {
+public:
+	// what an allocation was made for
+	enum Tag {
+		TAG_OTHER,
+		TAG_GAME,			// game simulation
+		TAG_AI,				// sensing and evaluating networks
+		TAG_BREEDING,		// building the next generation
+		TAG_RENDER,
+		TAG_IO,				// files and resources
+		TAG_MAX
+	};
+
+	// allocations over a period, in bytes where it applies
+	struct Stats {
+		Uint64 allocations = 0;
+		Uint64 frees = 0;
+		Uint64 bytes = 0;			// allocated during the period
+		Uint64 liveBytes = 0;		// still allocated at the end of it
+		Uint64 peakBytes = 0;		// most that were allocated at the end of any frame during it
+	};
+
+	// stats for each tag, and for all of them together
+	struct Report {
+		Stats tags[TAG_MAX];
+		Stats total;
+	};
+
+	// attributes allocations to a tag, from construction until destruction
+	class Scope {
+	public:
+		Scope(Tag tag) :
+			previous(getTag())
+		{
+			setTag(tag);
+		}
+		~Scope() {
+			setTag(previous);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Tag previous;
+	};
+
+	// getters & setters
+	static bool							isRecording()								{ return csvFile != nullptr; }
+	static const Report&				getFrameReport()							{ return frameReport; }
+
+	// @return the tag the calling thread's allocations are attributed to
+	static Tag getTag();
+
+	// @param tag the tag to attribute the calling thread's allocations to
+	static void setTag(Tag tag);
+
+	// @param tag the tag to look up
+	// @return the name of the tag
+	static const char* getTagName(Tag tag);
+
+	// tracked malloc(), realloc() and free(). blocks from one must only be passed to the others
+	static void* allocate(size_t size);
+	static void* reallocate(void* ptr, size_t size);
+	static void release(void* ptr);
+
+	// write a row to a csv file at the end of every frame, until stopped
+	// @param filename the file to write to, it is overwritten
+	// @return true if the file was opened
+	static bool startRecording(const char* filename);
+
+	// close the csv file
+	static void stopRecording();
+
+	// end the current frame: report what was allocated during it
+	static void endFrame();
+
+	// end a generation: log what was allocated during it
+	// @param generation the number of the generation that ended
+	static void endGeneration(int generation);
+
+private:
+	static FILE* csvFile;
+	static Report frameReport;
+};
+
+#ifdef NO_ALLOC_TRACKING
+inline Allocations::Tag Allocations::getTag() { return TAG_OTHER; }
+inline void Allocations::setTag(Tag tag) {}
+inline void* Allocations::allocate(size_t size) { return malloc(size); }
+inline void* Allocations::reallocate(void* ptr, size_t size) { return realloc(ptr, size); }
+inline void Allocations::release(void* ptr) { free(ptr); }
+#endif
@@ -0,0 +1,106 @@
+// Arena.cpp
+
+#include "Main.hpp"
+#include "Arena.hpp"
+
+#include <new>
+
+const size_t Arena::defaultChunkSize = 1 << 20;
+
+// chunk memory starts after the header, rounded up so it is aligned for anything
+static const size_t chunkHeaderSize = (sizeof(void*) * 2 + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+Arena::Arena() :
+	chunkSize(defaultChunkSize)
+{
+}
+
+Arena::Arena(size_t _chunkSize) :
+	chunkSize(_chunkSize)
+{
+}
+
+Arena::~Arena() {
+	release();
+}
+
+void* Arena::alloc(size_t bytes, size_t align) {
+	assert(align != 0 && (align & (align - 1)) == 0);
+	for (int tries = 0; tries < 2; ++tries) {
+		if (current) {
+			char* base = reinterpret_cast<char*>(current) + chunkHeaderSize;
+			const uintptr_t addr = reinterpret_cast<uintptr_t>(base + offset);
+			const size_t start = offset + (size_t)(((addr + align - 1) & ~(uintptr_t)(align - 1)) - addr);
+			if (start + bytes <= current->size) {
+				used += start + bytes - offset;
+				offset = start + bytes;
+				return base + start;
+			}
+		}
+		nextChunk(bytes, align);
+	}
+	assert(0); // nextChunk() always makes room
+	return nullptr;
+}
+
+void Arena::nextChunk(size_t bytes, size_t align) {
+	static_assert(sizeof(Chunk) <= chunkHeaderSize, "chunk header doesn't fit");
+	const size_t needed = bytes + align;
+
+	// chunks after the current one are free, take the next if it is big enough
+	Chunk* next = current ? current->next : first;
+	if (next && next->size >= needed) {
+		current = next;
+		offset = 0;
+		return;
+	}
+
+	// otherwise put a new chunk in front of it
+	const size_t size = std::max(chunkSize, needed);
+	Chunk* chunk = static_cast<Chunk*>(::operator new(chunkHeaderSize + size));
+	chunk->next = next;
+	chunk->size = size;
+	if (current) {
+		current->next = chunk;
+	} else {
+		first = chunk;
+	}
+	current = chunk;
+	offset = 0;
+	capacity += size;
+	++numChunks;
+}
+
+void Arena::reset() {
+	current = nullptr;
+	offset = 0;
+	used = 0;
+}
+
+void Arena::release() {
+	Chunk* next = nullptr;
+	for (Chunk* chunk = first; chunk != nullptr; chunk = next) {
+		next = chunk->next;
+		::operator delete(chunk);
+	}
+	first = nullptr;
+	current = nullptr;
+	offset = 0;
+	used = 0;
+	capacity = 0;
+	numChunks = 0;
+}
+
+Arena::Mark Arena::mark() const {
+	Mark m;
+	m.chunk = current;
+	m.offset = offset;
+	m.used = used;
+	return m;
+}
+
+void Arena::rewind(const Mark& m) {
+	current = static_cast<Chunk*>(m.chunk);
+	offset = m.offset;
+	used = m.used;
+}
@@ -0,0 +1,90 @@
+// Arena.hpp
+// Region allocator: bump-allocates from large chunks and frees everything at once
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <cstddef>
+
+// memory handed out by an arena is only released by reset(), rewind() or release()
+// individual frees are no-ops, and destructors of objects in the arena are the caller's business
+// an arena is not thread-safe
+class Arena {
+public:
+	Arena();
+	Arena(size_t _chunkSize);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// default size of each chunk of memory
+	static const size_t defaultChunkSize;
+
+	// getters & setters
+	size_t				getUsed() const				{ return used; }
+	size_t				getCapacity() const			{ return capacity; }
+	size_t				getNumChunks() const		{ return numChunks; }
+
+	// allocate memory from the arena
+	// @param bytes the number of bytes to allocate
+	// @param align the alignment of the memory (a power of two)
+	// @return the memory, valid until the arena is reset
+	void* alloc(size_t bytes, size_t align = alignof(std::max_align_t));
+
+	// free everything in the arena at once, keeping its chunks to allocate from again
+	void reset();
+
+	// free everything in the arena and give its chunks back to the heap
+	void release();
+
+	// a position in the arena to rewind to
+	struct Mark {
+		void* chunk = nullptr;
+		size_t offset = 0;
+		size_t used = 0;
+	};
+
+	// @return the current position in the arena
+	Mark mark() const;
+
+	// free everything allocated since a mark was taken
+	// @param m the mark to rewind to
+	void rewind(const Mark& m);
+
+	// rewinds an arena to where it was when the scope began
+	// declare it before anything that allocates from the arena, so it is destroyed last
+	class Scope {
+	public:
+		Scope(Arena& _arena) :
+			arena(_arena),
+			start(_arena.mark()) {}
+		~Scope() {
+			arena.rewind(start);
+		}
+	private:
+		Arena& arena;
+		Mark start;
+	};
+
+private:
+	// header at the start of each chunk, followed by its memory
+	struct Chunk {
+		Chunk* next;
+		size_t size;
+	};
+
+	size_t chunkSize = 0;
+	Chunk* first = nullptr;
+	Chunk* current = nullptr;
+	size_t offset = 0;		// bytes used in the current chunk
+	size_t used = 0;		// bytes used in all chunks, including padding
+	size_t capacity = 0;	// bytes in all chunks
+	size_t numChunks = 0;
+
+	// move on to a chunk with room for an allocation, creating one if needed
+	// @param bytes the size of the allocation
+	// @param align its alignment
+	void nextChunk(size_t bytes, size_t align);
+};
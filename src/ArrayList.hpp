@@ -3,33 +3,52 @@
 #pragma once
 
 #include "Main.hpp"
+#include "Arena.hpp"
 
+#include <new>
 #include <luajit-2.0/lua.hpp>
 #include <LuaBridge/LuaBridge.h>
 
 // templated ArrayList (similar to std::vector)
 // adding or removing elements can unsort the list.
+// storage comes from the heap, or from an arena given at construction (which then must outlive it)
 // @param T generic type that the list will contain
 template <typename T>
 class ArrayList {
 public:
 	ArrayList() {
-		alloc(4);
 	}
 
+	// @param _arena the arena to take storage from, or nullptr for the heap
+	explicit ArrayList(Arena* _arena) :
+		arena(_arena) {}
+
+	// copies are stored on the heap, whatever the source is stored in
 	ArrayList(const ArrayList& src) {
 		copy(src);
 	}
 
+	// @param src the list to copy
+	// @param _arena the arena to store the copy in, or nullptr for the heap
+	ArrayList(const ArrayList& src, Arena* _arena) :
+		arena(_arena)
+	{
+		copy(src);
+	}
+
+	ArrayList(ArrayList&& src) {
+		swap(src);
+	}
+
 	ArrayList(const std::initializer_list<T>& src) {
 		copy(src);
 	}
 
 	~ArrayList() {
-		if( arr ) {
-			delete[] arr;
-			arr = nullptr;
-		}
+		destroy(0, size);
+		size = 0;
+		deallocate(arr);
+		arr = nullptr;
 	}
 
 	// getters & setters
@@ -37,6 +56,7 @@ public:
 	T*				getArray()				{ return arr; }
 	size_t			getSize() const			{ return size; }
 	size_t			getMaxSize() const		{ return maxSize; }
+	Arena*			getArena() const		{ return arena; }
 
 	// @return true if list is empty
 	bool empty() const {
@@ -106,49 +126,61 @@ public:
 	}
 
 	// resize the internal list
+	// elements past the new capacity are destroyed
 	// @param len number of elements to size the list for
 	// @return *this
 	ArrayList& alloc(size_t len) {
+		if( len < size ) {
+			destroy(len, size);
+			size = len;
+		}
+		T* newArr = allocate(len);
+		relocate(newArr);
 		maxSize = len;
-		size_t newSize = std::min( maxSize, size );
-		T* newArr = nullptr;
-		if( len ) {
-			newArr = new T[len];
-			assert(newArr);
-			size_t copyLen = min(size, len);
-			for( size_t c = 0; c < copyLen; ++c ) {
-				newArr[c] = std::move(arr[c]);
-			}
+		return *this;
+	}
+
+	// make room for a number of elements, so adding that many won't reallocate
+	// @param len number of elements to make room for
+	// @return *this
+	ArrayList& reserve(size_t len) {
+		if( len > maxSize ) {
+			alloc(len);
 		}
-		if( arr ) {
-			delete[] arr;
-			arr = nullptr;
+		return *this;
+	}
+
+	// release any capacity beyond the current size
+	// @return *this
+	ArrayList& shrink_to_fit() {
+		if( maxSize > size ) {
+			alloc(size);
 		}
-		size = newSize;
-		arr = newArr;
 		return *this;
 	}
 
 	// fill the internal list, resizing if necessary
+	// new elements are default constructed, and removed ones destroyed
 	// @param len number of elements to size the list for
 	// @return *this
 	ArrayList& resize(size_t len) {
-		if( len > maxSize ) {
-			alloc(len);
-		}
+		reserve(len);
 		if( len > size ) {
 			for( size_t c = size; c < len; ++c ) {
-				arr[c] = T();
+				new (&arr[c]) T();
 			}
+		} else {
+			destroy(len, size);
 		}
 		size = len;
 		return *this;
 	}
 
-	// empty the list
+	// empty the list, keeping its capacity (use shrink_to_fit() to release it)
 	// @return *this
 	ArrayList& clear() {
-		alloc(0);
+		destroy(0, size);
+		size = 0;
 		return *this;
 	}
 
@@ -156,11 +188,15 @@ public:
 	// @param src the list to copy into our list
 	// @return *this;
 	ArrayList& copy(const ArrayList& src) {
-		alloc(src.getSize());
-		size = src.getSize();
+		if( &src == this ) {
+			return *this;
+		}
+		clear();
+		reserve(src.getSize());
 		for( size_t c = 0; c < src.getSize(); ++c ) {
-			arr[c] = src[c];
+			new (&arr[c]) T(src[c]);
 		}
+		size = src.getSize();
 		return *this;
 	}
 
@@ -168,23 +204,26 @@ public:
 	// @param src the array to copy into our list
 	// @return *this;
 	ArrayList& copy(const std::initializer_list<T>& src) {
-		alloc(src.size());
-		size = src.size();
-		const T* it;
-		size_t c;
-		for( c = 0, it = std::begin(src); it != std::end(src); ++it, ++c ) {
-			arr[c] = *it;
+		clear();
+		reserve(src.size());
+		for( const T* it = std::begin(src); it != std::end(src); ++it ) {
+			new (&arr[size]) T(*it);
+			++size;
 		}
 		return *this;
 	}
 
-	// quickly swap the internal array of this list with that of another list
+	// quickly swap the internal array (and where it is stored) of this list with that of another list
 	// @param src the list to swap with
 	void swap(ArrayList& src) {
 		auto tempArr = arr;
 		arr = src.arr;
 		src.arr = tempArr;
 
+		auto tempArena = arena;
+		arena = src.arena;
+		src.arena = tempArena;
+
 		auto tempMaxSize = maxSize;
 		maxSize = src.maxSize;
 		src.maxSize = tempMaxSize;
@@ -194,14 +233,35 @@ public:
 		src.size = tempSize;
 	}
 
-	// push a value onto the list
-	// @param val the value to push
-	void push(const T& val) {
+	// construct a value at the end of the list
+	// @param args the arguments to construct the value with (may refer to elements of this list)
+	// @return the new element
+	template <typename... Args>
+	T& emplace(Args&&... args) {
 		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
+			// build the new element before the old ones move, in case args refers to one
+			const size_t newMaxSize = std::max(size * 2, (size_t)4);
+			T* newArr = allocate(newMaxSize);
+			new (&newArr[size]) T(std::forward<Args>(args)...);
+			relocate(newArr);
+			maxSize = newMaxSize;
+		} else {
+			new (&arr[size]) T(std::forward<Args>(args)...);
 		}
 		++size;
-		arr[size-1] = val;
+		return arr[size-1];
+	}
+
+	// push a value onto the list
+	// @param val the value to push
+	void push(const T& val) {
+		emplace(val);
+	}
+
+	// push a value onto the list
+	// @param val the value to move into the list
+	void push(T&& val) {
+		emplace(std::move(val));
 	}
 
 	// insert a value into the list
@@ -209,27 +269,37 @@ public:
 	// @param pos the index to displace (move to the end of the list)
 	void insert(const T& val, size_t pos) {
 		assert(pos <= size);
-		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
+		if( pos == size ) {
+			emplace(val);
+		} else {
+			T temp(val);
+			emplace(std::move(arr[pos]));
+			arr[pos] = std::move(temp);
 		}
-		++size;
-		arr[size-1] = arr[pos];
-		arr[pos] = val;
 	}
 
 	// insert a value into the list, rearranging all elements after it
 	// @param val the value to insert
 	// @param pos the index to displace (move all elements starting here 1 index forward)
 	void insertAndRearrange(const T& val, size_t pos) {
+		insertAndRearrange(T(val), pos);
+	}
+
+	// move a value into the list, rearranging all elements after it
+	// @param val the value to insert
+	// @param pos the index to displace (move all elements starting here 1 index forward)
+	void insertAndRearrange(T&& val, size_t pos) {
 		assert(pos <= size);
-		if( size==maxSize ) {
-			alloc(std::max((unsigned int)size*2U, 4U));
-		}
-		++size;
-		for( size_t c = size-1; c > pos; --c ) {
-			arr[c] = arr[c-1];
+		if( pos == size ) {
+			emplace(std::move(val));
+		} else {
+			T temp(std::move(val));
+			emplace(std::move(arr[size-1]));
+			for( size_t c = size-2; c > pos; --c ) {
+				arr[c] = std::move(arr[c-1]);
+			}
+			arr[pos] = std::move(temp);
 		}
-		arr[pos] = val;
 	}
 
 	// removes and returns the last element from the list
@@ -237,7 +307,9 @@ public:
 	T pop() {
 		assert(size > 0);
 		--size;
-		return arr[size];
+		T result(std::move(arr[size]));
+		arr[size].~T();
+		return result;
 	}
 
 	// returns the last element in the list without removing it
@@ -259,9 +331,12 @@ public:
 	// @return the value at the given index
 	T remove(size_t pos) {
 		assert(size > pos);
-		T result = arr[pos];
+		T result(std::move(arr[pos]));
 		--size;
-		arr[pos] = arr[size];
+		if( pos != size ) {
+			arr[pos] = std::move(arr[size]);
+		}
+		arr[size].~T();
 		return result;
 	}
 
@@ -270,13 +345,14 @@ public:
 	// @return the value at the given index
 	T removeAndRearrange(size_t pos) {
 		assert(size > pos);
-		T result = arr[pos];
+		T result(std::move(arr[pos]));
 
 		size_t newSize = size - 1;
 		for( size_t c = pos; c < newSize; ++c ) {
-			arr[c] = arr[c+1];
+			arr[c] = std::move(arr[c+1]);
 		}
 
+		arr[newSize].~T();
 		--size;
 		return result;
 	}
@@ -288,6 +364,14 @@ public:
 		return copy(src);
 	}
 
+	// take the contents of another list, leaving it with our old ones
+	// @param src the list to move into our list
+	// @return *this;
+	ArrayList& operator=(ArrayList&& src) {
+		swap(src);
+		return *this;
+	}
+
 	// replace list contents with those of an array
 	// @param src the array to copy into our list
 	// @return *this;
@@ -343,19 +427,19 @@ public:
 	// sort the array list using the given function
 	// @param fn The sort function to use
 	void sort(const SortFunction& fn) {
-		ArrayList<T> result;
+		ArrayList<T> result(arena);
 		result.alloc(size);
 		for (int c = 0; c < size; ++c) {
 			bool foundPlace = false;
 			for (int i = 0; i < result.getSize(); ++i) {
 				if (fn(arr[c], result[i])) {
-					result.insertAndRearrange(arr[c], i);
+					result.insertAndRearrange(std::move(arr[c]), i);
 					foundPlace = true;
 					break;
 				}
 			}
 			if (!foundPlace) {
-				result.push(arr[c]);
+				result.push(std::move(arr[c]));
 			}
 		}
 		swap(result);
@@ -374,6 +458,9 @@ public:
 		typedef ArrayList<T>& (ArrayList<T>::*CopyFn)(const ArrayList<T>&);
 		CopyFn copy = static_cast<CopyFn>(&ArrayList<T>::copy);
 
+		typedef void (ArrayList<T>::*PushFn)(const T&);
+		PushFn push = static_cast<PushFn>(&ArrayList<T>::push);
+
 		typedef T& (ArrayList<T>::*PeekFn)();
 		PeekFn peek = static_cast<PeekFn>(&ArrayList<T>::peek);
 
@@ -395,10 +482,12 @@ public:
 			.addFunction("getMaxSize", &ArrayList<T>::getMaxSize)
 			.addFunction("empty", &ArrayList<T>::empty)
 			.addFunction("alloc", &ArrayList<T>::alloc)
+			.addFunction("reserve", &ArrayList<T>::reserve)
+			.addFunction("shrink_to_fit", &ArrayList<T>::shrink_to_fit)
 			.addFunction("resize", &ArrayList<T>::resize)
 			.addFunction("clear", &ArrayList<T>::clear)
 			.addFunction("copy", copy)
-			.addFunction("push", &ArrayList<T>::push)
+			.addFunction("push", push)
 			.addFunction("insert", &ArrayList<T>::insert)
 			.addFunction("pop", &ArrayList<T>::pop)
 			.addFunction("peek", peek)
@@ -415,4 +504,44 @@ private:
 	T* arr = nullptr;		// array data
 	size_t size = 0;		// current array capacity
 	size_t maxSize = 0;		// maximum array capacity
+	Arena* arena = nullptr;	// where the array is stored, nullptr for the heap
+
+	// @param len number of elements to get uninitialized storage for
+	// @return the storage, or nullptr if len is zero
+	T* allocate(size_t len) {
+		static_assert(alignof(T) <= alignof(std::max_align_t), "ArrayList does not support over-aligned types");
+		if( len == 0 ) {
+			return nullptr;
+		}
+		T* result = static_cast<T*>(arena ? arena->alloc(len * sizeof(T), alignof(T)) : ::operator new(len * sizeof(T)));
+		assert(result);
+		return result;
+	}
+
+	// @param ptr storage from allocate() to release (arena storage is left for the arena to free)
+	void deallocate(T* ptr) {
+		if( ptr && !arena ) {
+			::operator delete(ptr);
+		}
+	}
+
+	// destroy a range of elements, leaving their storage uninitialized
+	// @param first the first element to destroy
+	// @param last one past the last element to destroy
+	void destroy(size_t first, size_t last) {
+		for( size_t c = first; c < last; ++c ) {
+			arr[c].~T();
+		}
+	}
+
+	// move every element into new storage and release the old storage
+	// @param newArr storage with room for at least size elements
+	void relocate(T* newArr) {
+		for( size_t c = 0; c < size; ++c ) {
+			new (&newArr[c]) T(std::move(arr[c]));
+			arr[c].~T();
+		}
+		deallocate(arr);
+		arr = newArr;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+// Counters.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Counters.hpp"
+
+#include <chrono>
+
+const double Counters::summaryPeriod = 1.0;
+
+std::atomic<Uint32> Counters::counters[Counters::COUNTER_MAX];
+bool Counters::overlayVisible = false;
+FILE* Counters::csvFile = nullptr;
+Counters::Summary Counters::summary;
+
+static const char* counterNames[Counters::COUNTER_MAX] = {
+	"player entities",
+	"asteroid entities",
+	"alien entities",
+	"bullet entities",
+	"explosion entities",
+	"line3D draws",
+	"image draws",
+	"text draws",
+	"shader mounts",
+	"texture binds",
+	"buffer uploads",
+	"resource hits",
+	"resource misses",
+	"heap allocations"
+};
+
+// only touched by the thread that ends frames
+static Uint32 frameNumber = 0;
+static Uint32 periodFrames = 0;
+static double periodTotals[Counters::COUNTER_MAX] = { 0.0 };
+static std::chrono::steady_clock::time_point periodStart = std::chrono::steady_clock::now();
+
+const char* Counters::getName(Counter counter) {
+	assert(counter >= 0 && counter < COUNTER_MAX);
+	return counterNames[counter];
+}
+
+bool Counters::startRecording(const char* filename) {
+	stopRecording();
+	if( fopen_s(&csvFile, filename, "wb") || !csvFile ) {
+		csvFile = nullptr;
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to open '%s' to record counters", filename);
+		return false;
+	}
+
+	fprintf(csvFile, "frame");
+	for( int c = 0; c < COUNTER_MAX; ++c ) {
+		fprintf(csvFile, ",%s", counterNames[c]);
+	}
+	fprintf(csvFile, "\n");
+	mainEngine->fmsg(Engine::MSG_INFO, "recording counters to '%s'", filename);
+	return true;
+}
+
+void Counters::stopRecording() {
+	if( csvFile ) {
+		fclose(csvFile);
+		csvFile = nullptr;
+		mainEngine->fmsg(Engine::MSG_INFO, "stopped recording counters");
+	}
+}
+
+void Counters::endFrame() {
+	Uint32 values[COUNTER_MAX];
+	for( int c = 0; c < COUNTER_MAX; ++c ) {
+		values[c] = counters[c].exchange(0, std::memory_order_relaxed);
+	}
+	++frameNumber;
+
+	if( csvFile ) {
+		fprintf(csvFile, "%u", frameNumber);
+		for( int c = 0; c < COUNTER_MAX; ++c ) {
+			fprintf(csvFile, ",%u", values[c]);
+		}
+		fprintf(csvFile, "\n");
+	}
+
+	// turn the totals into averages once a period, so the overlay's text doesn't change every frame
+	++periodFrames;
+	for( int c = 0; c < COUNTER_MAX; ++c ) {
+		periodTotals[c] += values[c];
+	}
+	const auto now = std::chrono::steady_clock::now();
+	if( std::chrono::duration<double>(now - periodStart).count() >= summaryPeriod ) {
+		for( int c = 0; c < COUNTER_MAX; ++c ) {
+			summary.values[c] = periodTotals[c] / periodFrames;
+			periodTotals[c] = 0.0;
+		}
+		summary.frames = periodFrames;
+		++summary.serial;
+		periodFrames = 0;
+		periodStart = now;
+	}
+}
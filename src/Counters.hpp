@@ -0,0 +1,87 @@
+// Counters.hpp
+// Per-frame performance counters, with an overlay and csv export
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <atomic>
+
+// counters are bumped wherever the work happens (from any thread), and collected when a frame ends.
+// the overlay shows them averaged over the last second, a csv gets one row per frame
+class Counters {
+public:
+	enum Counter {
+		ENTITIES_PLAYER,		// entities alive at the end of the frame, in every game still running
+		ENTITIES_ASTEROID,
+		ENTITIES_ALIEN,
+		ENTITIES_BULLET,
+		ENTITIES_EXPLOSION,
+
+		DRAW_LINE3D,			// draw calls, by what issued them
+		DRAW_IMAGE,
+		DRAW_TEXT,
+
+		SHADER_MOUNTS,			// gl state changes
+		TEXTURE_BINDS,
+		BUFFER_UPLOADS,
+
+		RESOURCE_HITS,			// resource cache lookups
+		RESOURCE_MISSES,
+
+		HEAP_ALLOCATIONS,		// taken from Allocations at the end of the frame (0 if it is compiled out)
+
+		COUNTER_MAX
+	};
+
+	// averages over the frames of the last summary period
+	struct Summary {
+		Uint32 serial = 0;		// bumped whenever the summary changes
+		Uint32 frames = 0;
+		double values[COUNTER_MAX] = { 0.0 };
+	};
+
+	// how often the summary is refreshed, in seconds
+	static const double summaryPeriod;
+
+	// getters & setters
+	static bool							isOverlayVisible()							{ return overlayVisible; }
+	static bool							isRecording()								{ return csvFile != nullptr; }
+	static const Summary&				getSummary()								{ return summary; }
+	static void							setOverlayVisible(bool visible)				{ overlayVisible = visible; }
+
+	// @param counter the counter to look up
+	// @return the name of the counter, as shown in the overlay and the csv header
+	static const char* getName(Counter counter);
+
+	// count something happening this frame (safe to call from any thread)
+	// @param counter the counter to bump
+	// @param amount how many to add
+	static void add(Counter counter, Uint32 amount = 1) {
+		counters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	// set a counter that's sampled rather than counted, such as the number of entities
+	// @param counter the counter to set
+	// @param value its value this frame
+	static void set(Counter counter, Uint32 value) {
+		counters[counter].store(value, std::memory_order_relaxed);
+	}
+
+	// write a row to a csv file at the end of every frame, until stopped
+	// @param filename the file to write to, it is overwritten
+	// @return true if the file was opened
+	static bool startRecording(const char* filename);
+
+	// close the csv file
+	static void stopRecording();
+
+	// end the current frame: take and clear every counter, then summarize and record them
+	static void endFrame();
+
+private:
+	static std::atomic<Uint32> counters[COUNTER_MAX];
+	static bool overlayVisible;
+	static FILE* csvFile;
+	static Summary summary;
+};
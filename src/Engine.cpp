@@ -6,11 +6,18 @@
 #include "Directory.hpp"
 #include "Game.hpp"
 #include "AI.hpp"
+#include "Profiler.hpp"
+#include "Counters.hpp"
+#include "Allocations.hpp"
 
 #include <chrono>
 
 std::atomic_bool Engine::paused(false);
 std::atomic_bool Engine::timerRunning(true);
+Pacer Engine::pacer;
+
+const Uint32 Engine::maxFastForward = 64;
+const size_t Engine::maxLogLength = 1000;
 
 // log message code strings
 const char* Engine::msgTypeStr[Engine::MSG_TYPE_LENGTH] = {
@@ -24,6 +31,18 @@ const char* Engine::msgTypeStr[Engine::MSG_TYPE_LENGTH] = {
 	"CHAT"
 };
 
+// severity of each message code, for filtering by log level (notes and chat aren't problems, so they rank with info)
+const Uint32 Engine::msgTypeRank[Engine::MSG_TYPE_LENGTH] = {
+	0,	// DEBUG
+	1,	// INFO
+	2,	// WARN
+	3,	// ERROR
+	4,	// CRITICAL
+	5,	// FATAL
+	1,	// NOTE
+	1	// CHAT
+};
+
 Engine::Engine(int argc, char **argv):
 	game("base")
 {
@@ -37,14 +56,69 @@ Engine::Engine(int argc, char **argv):
 		frameval[c] = 0;
 	}
 
+	// command line
+	for( int c=1; c<argc; ++c ) {
+		if( (strcmp(argv[c], "-ff") == 0 || strcmp(argv[c], "--fast-forward") == 0) && c + 1 < argc ) {
+			setFastForward((Uint32)strtoul(argv[c + 1], nullptr, 10));
+			++c;
+		} else if( (strcmp(argv[c], "-st") == 0 || strcmp(argv[c], "--step-ticks") == 0) && c + 1 < argc ) {
+			setStepTicks((Uint32)strtoul(argv[c + 1], nullptr, 10));
+			++c;
+		} else if( (strcmp(argv[c], "-ar") == 0 || strcmp(argv[c], "--action-repeat") == 0) && c + 1 < argc ) {
+			setActionRepeat((Uint32)strtoul(argv[c + 1], nullptr, 10));
+			++c;
+		} else if( (strcmp(argv[c], "-ll") == 0 || strcmp(argv[c], "--log-level") == 0) && c + 1 < argc ) {
+			// eg. "--log-level warn" to skip info messages
+			msg_t level;
+			if( msgTypeForName(argv[c + 1], level) ) {
+				setLogLevel(level);
+			} else {
+				fmsg(MSG_WARN, "unknown log level '%s'", argv[c + 1]);
+			}
+			++c;
+		} else if( (strcmp(argv[c], "-rng") == 0 || strcmp(argv[c], "--rng") == 0) && c + 1 < argc ) {
+			// eg. "--rng rc4" to reproduce runs from before the faster generators
+			Random::Algorithm algorithm;
+			if( Random::algorithmForName(argv[c + 1], algorithm) ) {
+				Random::setDefaultAlgorithm(algorithm);
+				rand.setAlgorithm(algorithm);
+				rand.seedTime();
+			} else {
+				fmsg(MSG_WARN, "unknown random number generator '%s'", argv[c + 1]);
+			}
+			++c;
+		} else if( (strcmp(argv[c], "-cr") == 0 || strcmp(argv[c], "--counters") == 0) && c + 1 < argc ) {
+			// eg. "--counters counters.csv" to record every frame's counters from startup
+			counterFile = argv[c + 1];
+			++c;
+		} else if( (strcmp(argv[c], "-al") == 0 || strcmp(argv[c], "--allocations") == 0) && c + 1 < argc ) {
+			// eg. "--allocations allocations.csv" to record every frame's allocations from startup
+			allocationFile = argv[c + 1];
+			++c;
+		} else if( strcmp(argv[c], "-pf") == 0 || strcmp(argv[c], "--profile") == 0 ) {
+			Profiler::setOverlayVisible(true);
+		} else if( (strcmp(argv[c], "-tr") == 0 || strcmp(argv[c], "--trace") == 0) && c + 1 < argc ) {
+			// eg. "--trace 600" to record the first ten seconds to trace.json
+			traceFrames = (Uint32)strtoul(argv[c + 1], nullptr, 10);
+			++c;
+		} else if( strcmp(argv[c], "--selftest") == 0 ) {
+			selfTest = true;
+		} else if( strcmp(argv[c], "-bb") == 0 || strcmp(argv[c], "--binary-backups") == 0 ) {
+			binaryBackups = true;
+		}
+	}
+
 	// open log file
-	logLock = SDL_CreateMutex();
 	if( !logFile ) {
 		errno_t err = freopen_s(&logFile, "log.txt", "wb" /*or "wt"*/, stderr);
 		if (err || !logFile) {
 			mainEngine->fmsg(MSG_CRITICAL, "failed to open log file!");
 		}
 	}
+
+	// start writing messages in the background
+	logThreadRunning = true;
+	logThread = std::thread(&Engine::logThreadLoop, this);
 	fmsg(Engine::MSG_INFO,"hello.");
 }
 
@@ -125,10 +199,20 @@ void Engine::init() {
 	timerRunning = true;
 	timer = std::thread(&Engine::timerCallback, ticksPerSecond);
 	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+	lastStepTime = std::chrono::steady_clock::now();
 
 	// done
 	fmsg(Engine::MSG_INFO,"done");
 	initialized = true;
+	if( traceFrames ) {
+		Profiler::startCapture(traceFrames, "trace.json");
+	}
+	if( counterFile.length() ) {
+		Counters::startRecording(counterFile.get());
+	}
+	if( allocationFile.length() ) {
+		Allocations::startRecording(allocationFile.get());
+	}
 }
 
 void Engine::loadResources(const char* folder) {
@@ -149,12 +233,18 @@ void Engine::term() {
 		renderer = nullptr;
 	}
 
+	Counters::stopRecording();
+	Allocations::stopRecording();
+
 	// stop engine timer
 	fmsg(MSG_INFO,"closing engine...");
 	fmsg(MSG_INFO,"removing engine timer...");
 	timerRunning = false;
 	if (timer.joinable())
 		timer.join();
+	Pacer::Stats timerStats = pacer.getStats();
+	fmsg(MSG_INFO,"timer: %u ticks, %u missed, %.3f ms late on average (max %.3f ms, jitter %.3f ms)",
+		timerStats.ticks, timerStats.missed, timerStats.meanLateness, timerStats.maxLateness, timerStats.jitter);
 
 	// free sounds
 	Mix_HaltMusic();
@@ -180,11 +270,19 @@ void Engine::term() {
 	fmsg(MSG_INFO,"successfully shut down game engine.");
 	fmsg(MSG_INFO,"goodbye.");
 
+	// stop the log thread, and write out whatever it left behind
+	logThreadRunning = false;
+	logWake.notify_one();
+	if (logThread.joinable())
+		logThread.join();
+	flushLog();
+
 	if( logFile )
 		fclose(logFile);
 }
 
 void Engine::loadAllResources() {
+	PROFILE_SCOPE("Engine::loadAllResources");
 	fmsg(MSG_INFO,"loading engine resources...");
 
 	// reload the important assets
@@ -221,9 +319,8 @@ void Engine::dumpResources() {
 }
 
 void Engine::timerCallback(double interval) {
-	std::chrono::duration<double, std::ratio<1, 1>> msInterval( 1.0 / interval);
+	pacer.setTicksPerSecond(interval);
 	while (timerRunning) {
-		auto start = std::chrono::steady_clock::now();
 		if (!paused) {
 			SDL_Event event;
 			SDL_UserEvent userevent;
@@ -238,7 +335,7 @@ void Engine::timerCallback(double interval) {
 
 			SDL_PushEvent(&event);
 		}
-		while (std::chrono::steady_clock::now() - start < msInterval);
+		pacer.wait();
 	}
 }
 
@@ -248,122 +345,149 @@ void Engine::fmsg(const Uint32 msgType, const char* fmt, ...) {
 		return;
 	}
 #endif
-
-	// wait for current log to finish
-	if (!logLock) {
-		while( 1 ) {
-			SDL_LockMutex(logLock);
-			if( logging ) {
-				SDL_UnlockMutex(logLock);
-			} else {
-				logging = true;
-				SDL_UnlockMutex(logLock);
-				break;
-			}
-		}
+	assert(msgType < MSG_TYPE_LENGTH);
+	if( msgTypeRank[msgType] < msgTypeRank[logLevel.load(std::memory_order_relaxed)] ) {
+		return;
 	}
 
-	char str[1024];
-	str[1024-1] = '\0';
-
-	// format the string
+	// format the message straight into a slot of the queue
 	va_list argptr;
 	va_start( argptr, fmt );
-	vsnprintf( str, 1024, fmt, argptr );
+	auto fill = [&](logentry_t& entry) {
+		entry.kind = msgType;
+		entry.time = time(nullptr);
+		va_list args;
+		va_copy( args, argptr );
+		vsnprintf( entry.text, maxMessageLength, fmt, args );
+		va_end( args );
+		entry.text[maxMessageLength-1] = '\0';
+	};
+	while( !logQueue.push(fill) ) {
+		// full, wait for the log thread to catch up (or catch up ourselves if there isn't one)
+		if( logThreadRunning ) {
+			std::this_thread::yield();
+		} else {
+			writeLog();
+		}
+	}
 	va_end( argptr );
-	str[1024-1] = '\0';
-
-	// bust multi-line strings into individual strings...
-	for( size_t c=0; c<strlen(str); ++c ) {
-		if( str[c]=='\n' ) {
-			str[c]=0;
-
-			// disable lock temporarily
-			if (logLock) {
-				SDL_LockMutex(logLock);
-				logging = false;
-				SDL_UnlockMutex(logLock);
+
+	if( !logThreadRunning || msgType==MSG_CRITICAL || msgType==MSG_FATAL ) {
+		// nobody else will write it, or it might be the last thing we get to say
+		writeLog();
+	} else if( logThreadIdle ) {
+		logWake.notify_one();
+	}
+}
+
+// @return the color a message type is shown in
+static glm::vec3 msgColor(const Uint32 msgType) {
+	switch( msgType ) {
+		case Engine::MSG_DEBUG:
+			return glm::vec3(0.f,.7f,0.f);
+
+		case Engine::MSG_WARN:
+			return glm::vec3(1.f,1.f,0.f);
+		case Engine::MSG_ERROR:
+			return glm::vec3(1.f,.5f,0.f);
+		case Engine::MSG_CRITICAL:
+			return glm::vec3(1.f,0.f,1.f);
+		case Engine::MSG_FATAL:
+			return glm::vec3(1.f,0.f,0.f);
+
+		case Engine::MSG_INFO:
+			return glm::vec3(1.f,1.f,1.f);
+		case Engine::MSG_NOTE:
+			return glm::vec3(0.f,1.f,1.f);
+		case Engine::MSG_CHAT:
+			return glm::vec3(0.f,1.f,0.f);
+
+		default:
+			return glm::vec3(1.f,1.f,1.f);
+	}
+}
+
+void Engine::writeLog() {
+	std::lock_guard<std::mutex> writeGuard(logWriteLock);
+
+	bool wrote = false;
+	auto write = [this](logentry_t& entry) {
+		// timestamps only change once a second
+		if( entry.time != logTimeCached ) {
+			struct tm tm_info;
+			localtime_s(&tm_info, &entry.time);
+			strftime( logTimeStr, sizeof(logTimeStr), "%H-%M-%S", &tm_info );
+			logTimeCached = entry.time;
+		}
+
+		// each line of a message becomes its own log entry
+		char* line = entry.text;
+		for( ;; ) {
+			char* end = strchr(line, '\n');
+			if( end ) {
+				*end = '\0';
 			}
 
-			// write second line
-			fmsg(msgType,(const char *)(str+c+1));
-
-			// reactivate log lock
-			if (logLock) {
-				while( 1 ) {
-					SDL_LockMutex(logLock);
-					if( logging ) {
-						SDL_UnlockMutex(logLock);
-					} else {
-						logging = true;
-						SDL_UnlockMutex(logLock);
-						break;
-					}
+			// print message to stderr and stdout
+			fprintf( stderr, "[%s] %s: %s\r\n", logTimeStr, msgTypeStr[entry.kind], line );
+			fprintf( stdout, "[%s] %s: %s\r\n", logTimeStr, msgTypeStr[entry.kind], line );
+
+			// add message to log list
+			logmsg_t logMsg;
+			logMsg.text = line;
+			logMsg.kind = static_cast<msg_t>(entry.kind);
+			logMsg.color = msgColor(entry.kind);
+			{
+				std::lock_guard<std::mutex> guard(logLock);
+				logMsg.uid = logUids++;
+				logList.addNodeLast(logMsg);
+				while( logList.getSize() > maxLogLength ) {
+					logList.removeNode(logList.getFirst());
 				}
 			}
+
+			if( !end ) {
+				break;
+			}
+			line = end + 1;
 		}
+	};
+	while( logQueue.pop(write) ) {
+		wrote = true;
 	}
 
-	// create timestamp string
-	time_t timer;
-	char buffer[32];
-	struct tm tm_info;
-	time(&timer);
-	localtime_s(&tm_info, &timer);
-	strftime( buffer, 32, "%H-%M-%S", &tm_info );
-
-	// print message to stderr and stdout
-	fprintf( stderr, "[%s] %s: %s\r\n", buffer, (const char *)msgTypeStr[msgType], str );
-	fprintf( stdout, "[%s] %s: %s\r\n", buffer, (const char *)msgTypeStr[msgType], str );
-	fflush( stderr );
-	fflush( stdout );
-
-	// add message to log list
-	logmsg_t logMsg;
-	logMsg.text = str;
-	logMsg.uid = logUids++;
-	logMsg.kind = static_cast<msg_t>(msgType);
-	switch( msgType ) {
-		case MSG_DEBUG:
-			logMsg.color = glm::vec3(0.f,.7f,0.f);
-			break;
+	if( wrote ) {
+		fflush( stderr );
+		fflush( stdout );
+	}
+}
 
-		case MSG_WARN:
-			logMsg.color = glm::vec3(1.f,1.f,0.f);
-			break;
-		case MSG_ERROR:
-			logMsg.color = glm::vec3(1.f,.5f,0.f);
-			break;
-		case MSG_CRITICAL:
-			logMsg.color = glm::vec3(1.f,0.f,1.f);
-			break;
-		case MSG_FATAL:
-			logMsg.color = glm::vec3(1.f,0.f,0.f);
-			break;
+void Engine::flushLog() {
+	writeLog();
+}
 
-		case MSG_INFO:
-			logMsg.color = glm::vec3(1.f,1.f,1.f);
-			break;
-		case MSG_NOTE:
-			logMsg.color = glm::vec3(0.f,1.f,1.f);
-			break;
-		case MSG_CHAT:
-			logMsg.color = glm::vec3(0.f,1.f,0.f);
-			break;
+void Engine::logThreadLoop() {
+	while( logThreadRunning ) {
+		writeLog();
 
-		default:
-			logMsg.color = glm::vec3(1.f,1.f,1.f);
-			break;
+		// loggers only wake us while we're idle, and may just miss it, so don't wait long
+		std::unique_lock<std::mutex> lock(logWakeLock);
+		logThreadIdle = true;
+		if( logQueue.empty() && logThreadRunning ) {
+			logWake.wait_for(lock, std::chrono::milliseconds(10));
+		}
+		logThreadIdle = false;
 	}
+}
 
-	logList.addNodeLast(logMsg);
-
-	// unlock log stuff
-	if (logLock) {
-		SDL_LockMutex(logLock);
-		logging = false;
-		SDL_UnlockMutex(logLock);
+bool Engine::msgTypeForName(const char* name, msg_t& result) {
+	for( int c = 0; c < MSG_TYPE_LENGTH; ++c ) {
+		if( strcmpi(name, msgTypeStr[c]) == 0 ) {
+			result = (msg_t)c;
+			return true;
+		}
 	}
+	return false;
 }
 
 void Engine::smsg(const Uint32 msgType, const String& str) {
@@ -534,6 +658,7 @@ bool Engine::charsHaveLetters(const char *arr, size_t len) {
 }
 
 void Engine::preProcess() {
+	PROFILE_SCOPE("Engine::preProcess");
 	anykeystatus = false;
 
 	// lock mouse to window?
@@ -653,7 +778,6 @@ void Engine::preProcess() {
 				break;
 			case SDL_USEREVENT: // if the game timer has elapsed
 				++ticks;
-				++framesToRun;
 				ranFrames = true;
 				break;
 		}
@@ -663,7 +787,7 @@ void Engine::preProcess() {
 		omousey=mousey;
 	}
 
-	if( framesToRun ) {
+	if( ranFrames ) {
 		// calculate engine rate
 		t = SDL_GetTicks();
 		timesync = t-ot;
@@ -684,37 +808,134 @@ void Engine::preProcess() {
 	}
 }
 
+void Engine::setFastForward(Uint32 multiplier) {
+	fastForward = std::min(std::max(multiplier, (Uint32)1), maxFastForward);
+}
+
+void Engine::setStepTicks(Uint32 i) {
+	stepTicks = std::min(std::max(i, (Uint32)1), Game::maxStepTicks);
+}
+
+bool Engine::runSelfTests() {
+	bool passed = true;
+	passed = Game::testSweptCollisions() && passed;
+	fmsg(passed ? MSG_INFO : MSG_ERROR, "self tests %s", passed ? "passed" : "failed");
+	return passed;
+}
+
 void Engine::process() {
-	// game logic here
+	PROFILE_SCOPE("Engine::process");
+	// fast-forward hotkeys
+	if (pressKey(SDL_SCANCODE_EQUALS)) {
+		setFastForward(fastForward * 2);
+		fmsg(MSG_INFO, "fast-forward: x%u", fastForward);
+	}
+	if (pressKey(SDL_SCANCODE_MINUS)) {
+		setFastForward(fastForward / 2);
+		fmsg(MSG_INFO, "fast-forward: x%u", fastForward);
+	}
+
+	// profiler hotkeys
+	if (pressKey(SDL_SCANCODE_F3)) {
+		Profiler::setOverlayVisible(!Profiler::isOverlayVisible());
+	}
+	if (pressKey(SDL_SCANCODE_F4)) {
+		Profiler::startCapture(Profiler::defaultCaptureFrames, "trace.json");
+	}
+
+	// counter hotkeys
+	if (pressKey(SDL_SCANCODE_F5)) {
+		Counters::setOverlayVisible(!Counters::isOverlayVisible());
+	}
+	if (pressKey(SDL_SCANCODE_F6)) {
+		if (Counters::isRecording()) {
+			Counters::stopRecording();
+		} else {
+			Counters::startRecording("counters.csv");
+		}
+	}
+	if (pressKey(SDL_SCANCODE_F7)) {
+		if (Allocations::isRecording()) {
+			Allocations::stopRecording();
+		} else {
+			Allocations::startRecording("allocations.csv");
+		}
+	}
+
+	// accumulate simulation time
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed = now - lastStepTime;
+	lastStepTime = now;
+	if (!paused) {
+		stepAccumulator += elapsed.count() * fastForward;
+	}
+
+	// don't try to catch up after a stall, or we'll never render again
+	const double step = (double)stepTicks / ticksPerSecond;
+	stepAccumulator = std::min(stepAccumulator, step * fastForward * 4.0);
+
+	// game logic here, in fixed steps
 	bool allFinished = false;
-	while (framesToRun > 0) {
+	while (stepAccumulator >= step) {
+		stepAccumulator -= step;
 		if (ai) {
-			allFinished = ai->process() ? true : allFinished;
+			if (ai->process()) {
+				allFinished = true;
+				break;
+			}
 		}
 		else if (gamestate) {
 			gamestate->process();
 		}
-		--framesToRun;
 	}
+	renderAlpha = allFinished ? 1.f : (float)(stepAccumulator / step);
 	if (allFinished) {
+		stepAccumulator = 0.0;
 		ai->nextGeneration();
 	}
 }
 
-void Engine::postProcess() {
+bool Engine::postProcess() {
+	PROFILE_SCOPE("Engine::postProcess");
+	ALLOC_SCOPE(TAG_RENDER);
+	const bool rendered = ranFrames;
 	if (ranFrames) {
 		renderer->clearBuffers();
 		if (ai && ai->focus) {
-			ai->focus->draw(renderer->getCamera());
+			ai->focus->draw(renderer->getCamera(), renderAlpha);
 		}
 		else if (gamestate) {
-			gamestate->draw(renderer->getCamera());
+			gamestate->draw(renderer->getCamera(), renderAlpha);
+		}
+		StringBuf<32> buf("fps: %4.1f", fps);
+		if (fastForward > 1) {
+			buf.appendf("  x%u", fastForward);
 		}
-		StringBuf<16> buf("fps: %4.1f", fps);
 		Rect<Sint32> rect(10, yres - 20, 0, 0);
 		renderer->printTextColor(rect, glm::vec4(1.f, 0.f, 1.f, 1.f), buf.get());
+		if (Profiler::isOverlayVisible()) {
+			renderer->drawProfiler(Profiler::getSummary());
+		}
+		if (Counters::isOverlayVisible()) {
+			renderer->drawCounters(Counters::getSummary());
+		}
 		renderer->swapWindow();
 
+		// sample the entity counts
+		static_assert((int)Entity::Type::TYPE_MAX == Counters::DRAW_LINE3D - Counters::ENTITIES_PLAYER, "one counter per entity type");
+		Uint32 entityCounts[(int)Entity::Type::TYPE_MAX] = { 0 };
+		if (ai) {
+			ai->countEntities(entityCounts);
+		}
+		else if (gamestate) {
+			for (int c = 0; c < (int)Entity::Type::TYPE_MAX; ++c) {
+				entityCounts[c] = gamestate->countType((Entity::Type)c);
+			}
+		}
+		for (int c = 0; c < (int)Entity::Type::TYPE_MAX; ++c) {
+			Counters::set((Counters::Counter)(Counters::ENTITIES_PLAYER + c), entityCounts[c]);
+		}
+
 		mousexrel = 0;
 		mouseyrel = 0;
 		mousewheelx = 0;
@@ -723,6 +944,7 @@ void Engine::postProcess() {
 	}
 
 	++cycles;
+	return rendered;
 }
 
 String Engine::buildPath(const char* path) {
@@ -799,61 +1021,43 @@ bool Engine::removeMod(const char* name) {
 
 bool Engine::copyLog(LinkedList<Engine::logmsg_t>& dest) {
 	bool result = false;
+	std::lock_guard<std::mutex> guard(logLock);
 
-	// wait for current logging action to finish
-	while( 1 ) {
-		SDL_LockMutex(logLock);
-		if( logging ) {
-			SDL_UnlockMutex(logLock);
-		} else {
-			logging = true;
-			SDL_UnlockMutex(logLock);
-			break;
-		}
-	}
-
-	if( dest.getSize() == logList.getSize() ) {
-		SDL_LockMutex(logLock);
-		logging = false;
-		SDL_UnlockMutex(logLock);
-		return false;
-	} else if( dest.getSize() > logList.getSize() ) {
+	// messages from before the last clear are gone from the engine log
+	if( dest.getFirst() != nullptr && dest.getFirst()->getData().uid < logStartUid ) {
 		dest.removeAll();
 		result = true;
 	}
 
-	for( Node<Engine::logmsg_t>* node = logList.nodeForIndex(dest.getSize()); node != nullptr; node = node->getNext() ) {
-		Engine::logmsg_t newMsg;
-		newMsg = node->getData();
-		dest.addNodeLast(newMsg);
+	// find the first message newer than anything in dest
+	Node<Engine::logmsg_t>* node = logList.getLast();
+	if( dest.getLast() == nullptr ) {
+		node = logList.getFirst();
+	} else {
+		const unsigned int lastUid = dest.getLast()->getData().uid;
+		if( node != nullptr && node->getData().uid <= lastUid ) {
+			node = nullptr;
+		} else {
+			while( node != nullptr && node->getPrev() != nullptr && node->getPrev()->getData().uid > lastUid ) {
+				node = node->getPrev();
+			}
+		}
 	}
 
-	SDL_LockMutex(logLock);
-	logging = false;
-	SDL_UnlockMutex(logLock);
+	for( ; node != nullptr; node = node->getNext() ) {
+		dest.addNodeLast(node->getData());
+	}
+	while( dest.getSize() > maxLogLength ) {
+		dest.removeNode(dest.getFirst());
+	}
 
 	return result;
 }
 
 void Engine::clearLog() {
-
-	// wait for current logging action to finish
-	while( 1 ) {
-		SDL_LockMutex(logLock);
-		if( logging ) {
-			SDL_UnlockMutex(logLock);
-		} else {
-			logging = true;
-			SDL_UnlockMutex(logLock);
-			break;
-		}
-	}
-
+	std::lock_guard<std::mutex> guard(logLock);
 	logList.removeAll();
-
-	SDL_LockMutex(logLock);
-	logging = false;
-	SDL_UnlockMutex(logLock);
+	logStartUid = logUids;
 }
 
 Uint32 Engine::random() {
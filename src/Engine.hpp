@@ -13,9 +13,13 @@
 #include "Vector.hpp"
 #include "LinkedList.hpp"
 #include "Sound.hpp"
+#include "Pacer.hpp"
+#include "RingQueue.hpp"
 
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Game;
 class Renderer;
@@ -69,6 +73,18 @@ public:
 	// amount of ticks within which two clicks register as a "double-click"
 	static const unsigned int doubleClickTime = 30;
 
+	// largest number of simulation steps per tick when fast-forwarding
+	static const Uint32 maxFastForward;
+
+	// most messages kept in the log, older ones are dropped
+	static const size_t maxLogLength;
+
+	// messages that can be waiting to be written out by the log thread
+	static const size_t logQueueSize = 256;
+
+	// longest message, including its terminator. longer ones are cut short
+	static const size_t maxMessageLength = 1024;
+
 	// getters & setters
 	const bool							isInitialized() const							{ return initialized; }
 	const bool							isRunning() const								{ return running; }
@@ -96,6 +112,13 @@ public:
 	const double						getTimeSync() const								{ return timesync; }
 	const Uint32						getTicks() const								{ return ticks; }
 	const unsigned int					getTicksPerSecond() const						{ return ticksPerSecond; }
+	const Uint32						getFastForward() const							{ return fastForward; }
+	const Uint32						getStepTicks() const							{ return stepTicks; }
+	const Uint32						getActionRepeat() const							{ return actionRepeat; }
+	const Pacer::Stats					getTimerStats() const							{ return pacer.getStats(); }
+	const msg_t							getLogLevel() const								{ return (msg_t)logLevel.load(); }
+
+	void								setLogLevel(msg_t level)						{ logLevel = level; }
 	Resource<Sound>&					getSoundResource()								{ return soundResource; }
 	Resource<Image>&					getImageResource()								{ return imageResource; }
 	Resource<Material>&					getMaterialResource()							{ return materialResource; }
@@ -109,6 +132,8 @@ public:
 	const char*							getLastInput() const							{ return lastInput; }
 	LinkedList<SDL_GameController*>&	getControllers()								{ return controllers; }
 	const bool							isPlayTest() const								{ return playTest; }
+	const bool							isSelfTest() const								{ return selfTest; }
+	const bool							isBinaryBackups() const							{ return binaryBackups; }
 		
 	void								setPaused(const bool _paused)					{ paused = _paused; }
 	void								setInputStr(char* const _inputstr)				{ inputstr = _inputstr; inputnum = false; }
@@ -121,6 +146,19 @@ public:
 	void								setYres(const Sint32 i)							{ yres = i; }
 	void								setPlayTest(const bool b)						{ playTest = b; }
 	void								setConsoleSleep(Uint32 i)						{ consoleSleep = i; }
+	void								setActionRepeat(Uint32 i)						{ actionRepeat = std::max(i, 1u); }
+
+	// set how many simulation steps to run per tick
+	// @param multiplier the new multiplier, clamped to 1 - maxFastForward
+	void setFastForward(Uint32 multiplier);
+
+	// set how many ticks each game step covers
+	// @param i the new step length, clamped to 1 - Game::maxStepTicks
+	void setStepTicks(Uint32 i);
+
+	// run checks that don't need a window, logging the results
+	// @return true if every check passed
+	bool runSelfTests();
 
 	// initialize the engine
 	void init();
@@ -135,7 +173,8 @@ public:
 	// this does NOT unmount mods! It simply causes the engine to recache any loaded resources
 	void dumpResources();
 
-	// copy the contents of the engine log to another one
+	// copy the messages in the engine log that another one is missing
+	// the destination is trimmed to the same length as the engine log
 	// @param dest the destination log to copy to
 	// @return true if the dest was cleared in the process
 	bool copyLog(LinkedList<Engine::logmsg_t>& dest);
@@ -154,14 +193,24 @@ public:
 	// clears the log
 	void clearLog();
 
+	// write out every message logged so far, instead of leaving it to the log thread
+	void flushLog();
+
+	// look up a message type by name
+	// @param name the name of the type, eg. "warn" (as a log level, "note" and "chat" are the same as "info")
+	// @param result set to the type, if it was found
+	// @return true if the name matched a type
+	static bool msgTypeForName(const char* name, msg_t& result);
+
 	// shutdown the engine safely (perhaps from another class)
 	void shutdown();
 
 	// timer thread function (not actually a callback, name is a holdover)
-	// @param interval The exact time in ms between each heartbeat
+	// @param interval The number of heartbeats per second
 	static void timerCallback(double interval);
 
 	// logs a formatted char string to the console
+	// the message is formatted here and written out by the log thread, messages below the log level are skipped
 	// @param msgType the type of message to send to the console
 	// @param fmt a formatted string to print to the console
 	void fmsg(const Uint32 msgType, const char* fmt, ...);
@@ -247,7 +296,8 @@ public:
 	void process();
 
 	// perform post-processing on the current frame
-	void postProcess();
+	// @return true if a frame was drawn, false if the timer hadn't ticked yet
+	bool postProcess();
 
 	// return the value of a key and reset it if it's been pressed
 	// !IMPORTANT! should generally NOT be used, as it "locks" the key for the rest of the frame after being pressed
@@ -284,10 +334,17 @@ public:
 
 private:
 	static const char* msgTypeStr[MSG_TYPE_LENGTH];
+	static const Uint32 msgTypeRank[MSG_TYPE_LENGTH];
 
 	// shuts down the engine
 	void term();
 
+	// log thread function, writes out messages as they arrive
+	void logThreadLoop();
+
+	// write out the messages in the log queue, and add them to the log
+	void writeLog();
+
 	// general data
 	bool playTest = false;
 	String combinedVersion;
@@ -306,8 +363,25 @@ private:
 	LinkedList<logmsg_t> logList;
 	LinkedList<String> commandHistory;
 	unsigned int logUids = 0;
-	SDL_mutex* logLock = nullptr;
-	bool logging = false;
+	unsigned int logStartUid = 0; // uid of the first message since the log was last cleared
+	std::mutex logLock; // guards logList
+
+	// a message waiting to be written out
+	struct logentry_t {
+		Uint32 kind = MSG_INFO;
+		time_t time = 0;
+		char text[maxMessageLength];
+	};
+	RingQueue<logentry_t, logQueueSize> logQueue;
+	std::atomic<Uint32> logLevel{MSG_DEBUG}; // messages ranked below this type's severity are dropped
+	std::mutex logWriteLock; // held by whichever thread is emptying the queue
+	std::thread logThread;
+	std::atomic_bool logThreadRunning{false};
+	std::atomic_bool logThreadIdle{false};
+	std::mutex logWakeLock;
+	std::condition_variable logWake;
+	time_t logTimeCached = 0;
+	char logTimeStr[32] = "";
 
 	// renderer
 	Renderer* renderer = nullptr;
@@ -333,8 +407,19 @@ private:
 	Uint32 ticks=0, cycles=0, lastfpscount=0;
 	std::thread timer;
 	static std::atomic_bool timerRunning;
-	int framesToRun = 0;
+	static Pacer pacer; // paces the timer thread
 	bool ranFrames = false;
+	Uint32 fastForward = 1;
+	Uint32 stepTicks = 1; // ticks covered by each game step, see Game::setStepTicks()
+	Uint32 actionRepeat = 1; // game steps each AI decision is held for
+	double stepAccumulator = 0.0; // simulation time owed, in seconds
+	std::chrono::steady_clock::time_point lastStepTime;
+	float renderAlpha = 1.f; // fraction of a step between the last state and the present
+	Uint32 traceFrames = 0; // frames to capture a trace of once running, see --trace
+	String counterFile; // csv to record counters to once running, see --counters
+	String allocationFile; // csv to record allocations to once running, see --allocations
+	bool selfTest = false; // run the self tests instead of the game, see --selftest
+	bool binaryBackups = false; // write each generation's backup as .bin instead of .json, see --binary-backups
 
 	// console data
 	Uint32 consoleSleep = 0;
@@ -3,14 +3,18 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "File.hpp"
+#include "Allocations.hpp"
+
+#include <zlib.h>
 
-#include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/prettywriter.h"
-#include "rapidjson/error/en.h"
 
 const Uint32 BinaryFormatTag = 'spff';
 
+// size of zlib's buffers for each file (its default is 8KB)
+static const unsigned ioBufferSize = 1 << 17;
+
 class JsonFileWriter : public FileInterface {
 public:
 
@@ -20,15 +24,14 @@ public:
 	{
 	}
 
-	static bool writeObject(FILE * file, const FileHelper::SerializationFunc& serialize) {
+	static bool writeObject(gzFile file, const FileHelper::SerializationFunc& serialize) {
 		JsonFileWriter jfw;
 
 		jfw.beginObject();
 		serialize(&jfw);
 		jfw.endObject();
 
-		jfw.save(file);
-		return true;
+		return jfw.save(file);
 	}
 
 	virtual bool isReading() const override { return false; }
@@ -76,23 +79,257 @@ public:
 
 private:
 
-	void save(FILE * file) {
+	bool save(gzFile file) {
 		writer.Flush();
-		fputs(buffer.GetString(), file);
+		const size_t size = buffer.GetSize();
+		if (gzwrite(file, buffer.GetString(), (unsigned)size) != (int)size) {
+			int err = 0;
+			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileWriter: failed to write data (%s)", gzerror(file, &err));
+			return false;
+		}
+		return true;
 	}
 
-	FILE * fp;
 	rapidjson::StringBuffer buffer;
 	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer;
 };
 
+// pulls json tokens out of a file a buffer at a time, so the file never has to be in memory all at once
+// separators (',' and ':') are skipped rather than checked, which is all the reader needs
+class JsonTokenizer {
+public:
+	enum class Type {
+		BeginObject,
+		EndObject,
+		BeginArray,
+		EndArray,
+		String,
+		Number,
+		True,
+		False,
+		Null,
+		End,
+		Error
+	};
+
+	struct Token {
+		Type type = Type::End;
+		Uint32 text = 0;	// offset of the text of a string or number in the text list
+		Uint32 count = 0;	// number of items in an array
+	};
+
+	JsonTokenizer(gzFile file)
+	: fp(file)
+	{
+		buffer = (char *)Allocations::allocate(bufferSize);
+		assert(buffer);
+	}
+
+	~JsonTokenizer() {
+		Allocations::release(buffer);
+	}
+
+	// size of the buffer the file is read through
+	static const size_t bufferSize;
+
+	// @return the position in the file of the next char to read
+	size_t getOffset() const { return offset + pos; }
+
+	// go back to the start of the file
+	void rewind() {
+		gzrewind(fp);
+		offset = 0;
+		pos = 0;
+		len = 0;
+	}
+
+	// read the next token
+	// @param token the token to fill in
+	// @param text list to append the null terminated text of strings and numbers to, or nullptr to skip it
+	// @return false if the file isn't valid json
+	bool next(Token & token, ArrayList<char> * text) {
+		int c = peekChar();
+		while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ':') {
+			++pos;
+			c = peekChar();
+		}
+
+		token.count = 0;
+		token.text = text ? (Uint32)text->getSize() : 0;
+		switch (c) {
+		case EOF: token.type = Type::End; return true;
+		case '{': ++pos; token.type = Type::BeginObject; return true;
+		case '}': ++pos; token.type = Type::EndObject; return true;
+		case '[': ++pos; token.type = Type::BeginArray; return true;
+		case ']': ++pos; token.type = Type::EndArray; return true;
+		case '"': ++pos; token.type = Type::String; return readString(text);
+		case 't': token.type = Type::True; return readWord("true");
+		case 'f': token.type = Type::False; return readWord("false");
+		case 'n': token.type = Type::Null; return readWord("null");
+		default:
+			if (c == '-' || (c >= '0' && c <= '9')) {
+				token.type = Type::Number;
+				return readNumber(text);
+			}
+			token.type = Type::Error;
+			return false;
+		}
+	}
+
+private:
+
+	int peekChar() {
+		if (pos == len) {
+			offset += len;
+			pos = 0;
+			const int bytesRead = gzread(fp, buffer, (unsigned)bufferSize);
+			len = bytesRead > 0 ? (size_t)bytesRead : 0;
+			if (len == 0) {
+				return EOF;
+			}
+		}
+		return (unsigned char)buffer[pos];
+	}
+
+	int getChar() {
+		int c = peekChar();
+		if (c != EOF) {
+			++pos;
+		}
+		return c;
+	}
+
+	bool readWord(const char * word) {
+		for (const char * w = word; *w; ++w) {
+			if (getChar() != *w) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool readNumber(ArrayList<char> * text) {
+		for (int c = peekChar(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = peekChar()) {
+			if (text) {
+				text->push((char)c);
+			}
+			++pos;
+		}
+		if (text) {
+			text->push('\0');
+		}
+		return true;
+	}
+
+	bool readString(ArrayList<char> * text) {
+		for (;;) {
+			int c = getChar();
+			if (c == EOF || (c >= 0 && c < ' ')) {
+				return false;
+			}
+			if (c == '"') {
+				break;
+			}
+			if (c == '\\') {
+				c = getChar();
+				switch (c) {
+				case '"': case '\\': case '/': break;
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 't': c = '\t'; break;
+				case 'u': {
+					Uint32 code = 0;
+					if (!readHex(code)) {
+						return false;
+					}
+					if (code >= 0xD800 && code < 0xDC00) {
+						// surrogate pair
+						Uint32 low = 0;
+						if (getChar() != '\\' || getChar() != 'u' || !readHex(low) || low < 0xDC00 || low >= 0xE000) {
+							return false;
+						}
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					if (text) {
+						pushUtf8(*text, code);
+					}
+					continue;
+				}
+				default: return false;
+				}
+			}
+			if (text) {
+				text->push((char)c);
+			}
+		}
+		if (text) {
+			text->push('\0');
+		}
+		return true;
+	}
+
+	bool readHex(Uint32 & code) {
+		for (int digit = 0; digit < 4; ++digit) {
+			int c = getChar();
+			code <<= 4;
+			if (c >= '0' && c <= '9') {
+				code |= c - '0';
+			} else if (c >= 'a' && c <= 'f') {
+				code |= c - 'a' + 10;
+			} else if (c >= 'A' && c <= 'F') {
+				code |= c - 'A' + 10;
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void pushUtf8(ArrayList<char> & text, Uint32 code) {
+		if (code < 0x80) {
+			text.push((char)code);
+		} else if (code < 0x800) {
+			text.push((char)(0xC0 | (code >> 6)));
+			text.push((char)(0x80 | (code & 0x3F)));
+		} else if (code < 0x10000) {
+			text.push((char)(0xE0 | (code >> 12)));
+			text.push((char)(0x80 | ((code >> 6) & 0x3F)));
+			text.push((char)(0x80 | (code & 0x3F)));
+		} else {
+			text.push((char)(0xF0 | (code >> 18)));
+			text.push((char)(0x80 | ((code >> 12) & 0x3F)));
+			text.push((char)(0x80 | ((code >> 6) & 0x3F)));
+			text.push((char)(0x80 | (code & 0x3F)));
+		}
+	}
+
+	gzFile fp = nullptr;
+	char * buffer = nullptr;
+	size_t offset = 0;	// position in the file of the start of the buffer
+	size_t pos = 0;		// next char in the buffer
+	size_t len = 0;		// chars in the buffer
+};
+
+const size_t JsonTokenizer::bufferSize = 1 << 16;
+
+// reads json straight from the file in the order the serialize functions ask for it
+// a first pass counts the items in each array, since beginArray() needs to know up front.
+// properties are expected in the order they were written. if one is asked for out of order (or is missing),
+// the rest of that object is buffered and looked up in memory instead, and everything inside it is read from there
 class JsonFileReader : public FileInterface {
 public:
 
-	static bool readObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
-		JsonFileReader jfr;
+	JsonFileReader(gzFile file)
+	: tokenizer(file)
+	{
+	}
+
+	static bool readObject(gzFile fp, const FileHelper::SerializationFunc & serialize) {
+		JsonFileReader jfr(fp);
 
-		if (!jfr.readAllFileData(fp)) {
+		if (!jfr.countArrays()) {
 			return false;
 		}
 
@@ -100,157 +337,381 @@ public:
 		serialize(&jfr);
 		jfr.endObject();
 
-		return true;
+		return !jfr.failed;
 	}
 
 	virtual bool isReading() const override { return true; }
 
 	virtual void beginObject() override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsObject());
-		DocIterator di;
-		di.it = cv;
-		di.index = -1;
-		stack.push(di);
+		Frame frame;
+		if (nextValue(Type::BeginObject)) {
+			beginFrame(frame);
+		}
+		stack.push(frame);
 	}
 
 	virtual void endObject() override {
-		stack.pop();
+		endFrame();
 	}
 
 	virtual void beginArray(Uint32 & size) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsArray());
-		DocIterator di;
-		di.it = cv;
-		di.index = 0;
-		stack.push(di);
-		size = di.it->GetArray().Size();
+		Frame frame;
+		frame.array = true;
+		size = 0;
+		if (const Token * token = nextValue(Type::BeginArray)) {
+			size = token->count;
+			beginFrame(frame);
+		}
+		stack.push(frame);
 	}
 
 	virtual void endArray() override {
-		stack.pop();
+		endFrame();
 	}
+
 	virtual void propertyName(const char * fieldName) override {
 		propName = fieldName;
 	}
+
 	virtual void value(int64_t& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsInt());
-		value = cv->GetInt();
+		if (const Token * token = nextValue(Type::Number)) {
+			value = strtoll(getText(*token), nullptr, 10);
+		}
 	}
 	virtual void value(Uint32& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsUint());
-		value = cv->GetUint();
+		if (const Token * token = nextValue(Type::Number)) {
+			value = (Uint32)strtoul(getText(*token), nullptr, 10);
+		}
 	}
 	virtual void value(Sint32& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsInt());
-		value = cv->GetInt();
+		if (const Token * token = nextValue(Type::Number)) {
+			value = (Sint32)strtol(getText(*token), nullptr, 10);
+		}
 	}
 	virtual void value(float& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsFloat());
-		value = cv->GetFloat();
+		if (const Token * token = nextValue(Type::Number)) {
+			value = strtof(getText(*token), nullptr);
+		}
 	}
 	virtual void value(double& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsDouble());
-		value = cv->GetDouble();
+		if (const Token * token = nextValue(Type::Number)) {
+			value = strtod(getText(*token), nullptr);
+		}
 	}
 	virtual void value(bool& value) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsBool());
-		value = cv->GetBool();
+		if (const Token * token = nextValue(Type::True)) {
+			value = token->type == Type::True;
+		}
 	}
 	virtual void value(String& value, Uint32 maxLength) override {
-		auto cv = GetCurrentValue();
-		assert(cv->IsString());
-		assert(maxLength == 0 || cv->GetStringLength() <= maxLength);
-		value = cv->GetString();
+		if (const Token * token = nextValue(Type::String)) {
+			value = getText(*token);
+			assert(maxLength == 0 || value.length() <= maxLength);
+		}
 	}
 
-protected:
+private:
 
-	rapidjson::Value::ConstValueIterator GetCurrentValue() {
-		if (stack.empty()) {
-			assert(propName == nullptr);
-			return &doc;
-		}
+	typedef JsonTokenizer::Token Token;
+	typedef JsonTokenizer::Type Type;
+
+	// the index of a value that isn't buffered
+	static const Uint32 notBuffered;
+
+	// an object or array being read. missing ones are empty and buffered, so nothing more is read for them
+	struct Frame {
+		bool array = false;
+		bool buffered = true;	// members or items are read from the buffer instead of the file
+		bool ended = true;		// the closing token has been read
+		Uint32 begin = 0;		// the next item of a buffered array, or first member of a buffered object
+		Uint32 end = 0;			// the closing token of a buffered object or array
+		Uint32 bufferStart = notBuffered;	// size of the buffer before this frame added to it
+		Uint32 textStart = 0;	// size of the buffered text before this frame added to it
+	};
 
-		DocIterator& di = stack.peek();
-		if (di.it->IsArray()) {
-			assert(di.index >= 0);
-			return &di.it->GetArray()[di.index++];
+	// read through the whole file once, counting the items in every array
+	// @return true if the file is valid
+	bool countArrays() {
+		const Uint32 object = UINT32_MAX;
+		ArrayList<Uint32> open; // arrays (as their index in arrayCounts) and objects that haven't been closed yet
+		Token token;
+		for (;;) {
+			if (!tokenizer.next(token, nullptr)) {
+				parseError();
+				return false;
+			}
+			if (token.type == Type::End) {
+				break;
+			}
+			if (token.type == Type::EndObject || token.type == Type::EndArray) {
+				if (open.empty()) {
+					break;
+				}
+				open.pop();
+				continue;
+			}
+			if (!open.empty() && open.peek() != object) {
+				++arrayCounts[open.peek()];
+			}
+			if (token.type == Type::BeginObject) {
+				open.push(object);
+			} else if (token.type == Type::BeginArray) {
+				open.push((Uint32)arrayCounts.getSize());
+				arrayCounts.push(0);
+			}
 		}
-
-		assert(propName != nullptr);
-		rapidjson::Value::ConstValueIterator result = &(*di.it)[propName];
-		propName = nullptr;
-		return result;
+		if (!open.empty()) {
+			error("JsonFileReader: unexpected end of file");
+			return false;
+		}
+		tokenizer.rewind();
+		return true;
 	}
 
-	bool readAllFileData(FILE * fp) {
-		if (fseek(fp, 0, SEEK_END)) {
-			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileReader: failed to seek end (%d)", errno);
+	// read a token from the file, filling in the item count of arrays
+	// @param token the token to fill in
+	// @param text where to put its text
+	// @return false on a parse error
+	bool readToken(Token & token, ArrayList<char> & text) {
+		if (!tokenizer.next(token, &text)) {
+			parseError();
 			return false;
 		}
+		if (token.type == Type::BeginArray) {
+			token.count = nextArray < arrayCounts.getSize() ? arrayCounts[nextArray] : 0;
+			++nextArray;
+		}
+		return true;
+	}
 
-		long size = ftell(fp);
-		if (fseek(fp, 0, SEEK_SET)) {
-			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileReader: failed to seek beg (%d)", errno);
-			return false;
+	// read from the file up to the end of the object or array that is open, buffering what is read if asked
+	// @param buffer true to keep the tokens
+	// @return false on a parse error
+	bool readToEnd(bool buffer) {
+		for (int depth = 0; !failed;) {
+			Token token;
+			ArrayList<char> & text = buffer ? bufferedText : scratch;
+			if (!buffer) {
+				scratch.clear();
+			}
+			if (!readToken(token, text)) {
+				return false;
+			}
+			if (token.type == Type::End) {
+				error("JsonFileReader: unexpected end of file");
+				return false;
+			}
+			if (token.type == Type::EndObject || token.type == Type::EndArray) {
+				if (depth-- == 0) {
+					return true;
+				}
+			} else if (token.type == Type::BeginObject || token.type == Type::BeginArray) {
+				++depth;
+			}
+			if (buffer) {
+				buffered.push(token);
+			}
 		}
+		return false;
+	}
 
-		// reserve an extra byte for the null terminator
-		char * data = (char *)calloc(sizeof(char), size + 1);
-		assert(data);
+	// @return the index of the buffered token after the value that starts at index
+	Uint32 skipValue(Uint32 index) const {
+		int depth = 0;
+		do {
+			const Type type = buffered[index].type;
+			if (type == Type::BeginObject || type == Type::BeginArray) {
+				++depth;
+			} else if (type == Type::EndObject || type == Type::EndArray) {
+				--depth;
+			}
+			++index;
+		} while (depth > 0 && index < buffered.getSize());
+		return index;
+	}
+
+	// find the next value to read: the named property of an object or the next item of an array
+	// @param expected the type of token wanted (True stands for either bool)
+	// @return the first token of the value, or nullptr if there is none
+	const Token * nextValue(Type expected) {
+		const char * name = propName;
+		propName = nullptr;
+		if (failed) {
+			return nullptr;
+		}
 
-		size_t bytesRead = fread(data, sizeof(char), size, fp);
-		if (bytesRead != size) {
-			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileReader: failed to read data (%d)", errno);
-			free(data);
-			return false;
+		const Token * token = nullptr;
+		valueIndex = notBuffered;
+		if (stack.empty()) {
+			// the root object
+			scratch.clear();
+			token = readToken(current, scratch) ? &current : nullptr;
+		} else {
+			Frame & frame = stack.peek();
+			if (frame.array) {
+				if (frame.buffered) {
+					if (frame.begin < frame.end) {
+						valueIndex = frame.begin;
+						frame.begin = skipValue(frame.begin);
+					}
+				} else if (!frame.ended) {
+					scratch.clear();
+					if (readToken(current, scratch)) {
+						if (current.type == Type::EndArray) {
+							frame.ended = true;
+						} else {
+							token = &current;
+						}
+					}
+				}
+			} else {
+				assert(name);
+				if (!frame.buffered) {
+					if (frame.ended) {
+						frame.buffered = true;
+					} else {
+						// the next member is usually the one wanted
+						scratch.clear();
+						if (!readToken(current, scratch)) {
+							return nullptr;
+						}
+						if (current.type == Type::String && strcmp(getText(current), name) == 0) {
+							if (readToken(current, scratch)) {
+								token = &current;
+							}
+						} else {
+							bufferRest(frame);
+						}
+					}
+				}
+				if (frame.buffered) {
+					for (Uint32 index = frame.begin; index < frame.end; index = skipValue(index + 1)) {
+						if (strcmp(getText(buffered[index]), name) == 0) {
+							valueIndex = index + 1;
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (valueIndex != notBuffered) {
+			token = &buffered[valueIndex];
+		}
+		if (!token || failed) {
+			return nullptr;
 		}
 
-		// null terminate
-		data[size] = 0;
+		const bool matches = token->type == expected || (expected == Type::True && token->type == Type::False);
+		if (!matches) {
+			StringBuf<256> msg("JsonFileReader: unexpected value type for '%s' at offset %llu", name ? name : "",
+				(unsigned long long)tokenizer.getOffset());
+			error(msg.get());
+			return nullptr;
+		}
+		return token;
+	}
+
+	// buffer the rest of an object that is being read from the file, after its members turned up out of order
+	// @param frame the object, whose first remaining member (or end) is in current
+	void bufferRest(Frame & frame) {
+		frame.buffered = true;
+		frame.bufferStart = (Uint32)buffered.getSize();
+		frame.textStart = (Uint32)bufferedText.getSize();
+		frame.begin = frame.bufferStart;
+		if (current.type != Type::EndObject) {
+			if (current.type != Type::String) {
+				error("JsonFileReader: expected a property name");
+				return;
+			}
+			current.text = (Uint32)bufferedText.getSize();
+			for (const char * c = &scratch[0]; *c; ++c) {
+				bufferedText.push(*c);
+			}
+			bufferedText.push('\0');
+			buffered.push(current);
+			readToEnd(true);
+		}
+		frame.end = (Uint32)buffered.getSize();
+		frame.ended = true;
+	}
+
+	// start reading the object or array that nextValue() found
+	// @param frame the frame to set up
+	void beginFrame(Frame & frame) {
+		if (valueIndex == notBuffered) {
+			frame.buffered = false;
+			frame.ended = false;
+		} else {
+			frame.begin = valueIndex + 1;
+			frame.end = skipValue(valueIndex) - 1;
+		}
+	}
 
-		rapidjson::ParseResult result = doc.Parse(data);
+	// finish reading an object or array, skipping whatever wasn't read
+	void endFrame() {
+		assert(!stack.empty());
+		Frame frame = stack.pop();
+		if (!frame.ended && !failed) {
+			readToEnd(false);
+		}
+		if (frame.bufferStart != notBuffered) {
+			buffered.resize(frame.bufferStart);
+			bufferedText.resize(frame.textStart);
+		}
+	}
 
-		free(data);
+	const char * getText(const Token & token) const {
+		const ArrayList<char> & text = &token == &current ? scratch : bufferedText;
+		return &text[token.text];
+	}
 
-		if (!result) {
-			mainEngine->fmsg(Engine::MSG_ERROR, "JsonFileReader: parse error: %s (%d)", rapidjson::GetParseError_En(result.Code()), result.Offset());
-			return false;
+	// stop reading, reporting the first error only
+	// @param msg the error
+	void error(const char * msg) {
+		if (!failed) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "%s", msg);
+			failed = true;
 		}
+	}
 
-		return true;
+	void parseError() {
+		StringBuf<64> msg("JsonFileReader: parse error at offset %llu", (unsigned long long)tokenizer.getOffset());
+		error(msg.get());
 	}
 
-	struct DocIterator {
-		rapidjson::Value::ConstValueIterator it;
-		Uint32 index;
-	};
+	JsonTokenizer tokenizer;
+	ArrayList<Uint32> arrayCounts;	// the number of items in each array, in the order they appear
+	size_t nextArray = 0;			// the next array to be read from the file
 
-	rapidjson::Document doc;
+	Token current;					// the last token read from the file
+	ArrayList<char> scratch;		// text of the last token read from the file
+	ArrayList<Token> buffered;		// tokens of objects that are being read out of order
+	ArrayList<char> bufferedText;	// text of the buffered tokens
+	Uint32 valueIndex = notBuffered;	// index of the value being read, if it is buffered
+
+	ArrayList<Frame> stack;
 	const char * propName = nullptr;
-	ArrayList<DocIterator> stack;
+	bool failed = false;
 };
 
+const Uint32 JsonFileReader::notBuffered = UINT32_MAX;
+
 class BinaryFileWriter : public FileInterface {
 public:
 
-	BinaryFileWriter(FILE * file)
+	BinaryFileWriter(gzFile file)
 	: fp(file)
 	{
 	}
 
 	~BinaryFileWriter() {
+		Allocations::release(buffer);
 	}
 
-	static bool writeObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
+	// the buffer is written out once it holds this many bytes
+	static const size_t flushSize;
+
+	static bool writeObject(gzFile fp, const FileHelper::SerializationFunc & serialize) {
 		BinaryFileWriter bfw(fp);
 
 		bfw.writeHeader();
@@ -259,7 +720,8 @@ public:
 		serialize(&bfw);
 		bfw.endObject();
 
-		return true;
+		bfw.flush();
+		return !bfw.failed;
 	}
 
 	virtual bool isReading() const override { return false; }
@@ -271,7 +733,7 @@ public:
 	}
 
 	virtual void beginArray(Uint32 & size) override {
-		fwrite(&size, sizeof(size), 1, fp);
+		write(&size, sizeof(size));
 	}
 
 	virtual void endArray() override {
@@ -281,56 +743,122 @@ public:
 	}
 
 	virtual void value(int64_t& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(Uint32& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(Sint32& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(float& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(double& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		write(&v, sizeof(v));
 	}
 	virtual void value(bool& v) override {
-		fwrite(&v, sizeof(v), 1, fp);
+		Uint8 byte = v ? 1 : 0;
+		write(&byte, sizeof(byte));
 	}
 	virtual void value(String& v, Uint32 maxLength) override {
 		assert(maxLength == 0 || v.getSize() <= maxLength);
 		writeStringInternal(v);
 	}
 
+	virtual bool rawBlock(void* data, size_t size) override {
+		write(data, size);
+		return true;
+	}
+
 private:
 
 	void writeHeader() {
-		fwrite(&BinaryFormatTag, sizeof(BinaryFormatTag), 1, fp);
+		write(&BinaryFormatTag, sizeof(BinaryFormatTag));
 	}
 
 	void writeStringInternal(const String& v) {
 		Uint32 len = (Uint32)v.getSize();
-		fwrite(&len, sizeof(len), 1, fp);
-		if (len) {
-			fwrite(v.get(), sizeof(char), len, fp);
+		write(&len, sizeof(len));
+		write(v.get(), len);
+	}
+
+	// append bytes to the buffer, growing it until it is big enough to flush
+	// @param data the bytes to write
+	// @param size the number of bytes
+	void write(const void * data, size_t size) {
+		if (size == 0) {
+			return;
+		}
+		if (size >= flushSize) {
+			// big blocks skip the buffer
+			flush();
+			writeToFile(data, size);
+			return;
+		}
+		if (used + size > capacity) {
+			size_t newCapacity = capacity ? capacity : 4096;
+			while (newCapacity < used + size) {
+				newCapacity *= 2;
+			}
+			char * newBuffer = (char *)Allocations::reallocate(buffer, newCapacity);
+			assert(newBuffer);
+			buffer = newBuffer;
+			capacity = newCapacity;
+		}
+		memcpy(buffer + used, data, size);
+		used += size;
+		if (used >= flushSize) {
+			flush();
+		}
+	}
+
+	// write the buffer out to the file
+	void flush() {
+		if (used) {
+			writeToFile(buffer, used);
+			used = 0;
+		}
+	}
+
+	void writeToFile(const void * data, size_t size) {
+		if (failed) {
+			return;
+		}
+		if (gzwrite(fp, data, (unsigned)size) != (int)size) {
+			int err = 0;
+			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileWriter: failed to write data (%s)", gzerror(fp, &err));
+			failed = true;
 		}
 	}
 
-	FILE* fp = nullptr;
+	gzFile fp = nullptr;
+	char* buffer = nullptr;
+	size_t used = 0;
+	size_t capacity = 0;
+	bool failed = false;
 };
 
+const size_t BinaryFileWriter::flushSize = 1 << 18;
+
 class BinaryFileReader : public FileInterface {
 public:
 
-	BinaryFileReader(FILE * file)
+	BinaryFileReader(gzFile file)
 		: fp(file)
 	{
 	}
 
-	static bool readObject(FILE * fp, const FileHelper::SerializationFunc & serialize) {
+	~BinaryFileReader() {
+		Allocations::release(data);
+	}
+
+	static bool readObject(gzFile fp, const FileHelper::SerializationFunc & serialize) {
 		BinaryFileReader bfr(fp);
 
+		if (!bfr.readAllFileData()) {
+			return false;
+		}
 		if (!bfr.readHeader()) {
 			return false;
 		}
@@ -339,7 +867,7 @@ public:
 		serialize(&bfr);
 		bfr.endObject();
 
-		return true;
+		return !bfr.failed;
 	}
 
 	virtual bool isReading() const override { return true; }
@@ -351,8 +879,13 @@ public:
 	}
 
 	virtual void beginArray(Uint32 & size) override {
-		size_t read = fread(&size, sizeof(size), 1, fp);
-		assert(read == 1);
+		read(&size, sizeof(size));
+
+		// every item takes at least a byte, so a bigger count can only come from a bad file
+		if (size > getRemaining()) {
+			fail(size);
+			size = 0;
+		}
 	}
 
 	virtual void endArray() override {
@@ -362,41 +895,66 @@ public:
 	}
 
 	virtual void value(int64_t& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		read(&v, sizeof(v));
 	}
 	virtual void value(Uint32& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		read(&v, sizeof(v));
 	}
 	virtual void value(Sint32& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		read(&v, sizeof(v));
 	}
 	virtual void value(float& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		read(&v, sizeof(v));
 	}
 	virtual void value(double& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		read(&v, sizeof(v));
 	}
 	virtual void value(bool& v) override {
-		size_t read = fread(&v, sizeof(v), 1, fp);
-		assert(read == 1);
+		Uint8 byte = 0;
+		read(&byte, sizeof(byte));
+		v = byte != 0;
 	}
 	virtual void value(String& v, Uint32 maxLength) override {
 		readStringInternal(v);
 		assert(maxLength == 0 || v.getSize() <= maxLength);
 	}
 
+	virtual bool rawBlock(void* dest, size_t size) override {
+		read(dest, size);
+		return true;
+	}
+
 private:
 
+	// read the whole file into memory. a compressed file's size isn't known until it has been inflated,
+	// so the buffer grows as it fills
+	bool readAllFileData() {
+		size_t capacity = 1 << 16;
+		data = (char *)Allocations::allocate(capacity);
+		assert(data);
+		for (;;) {
+			if (size == capacity) {
+				capacity *= 2;
+				char * newData = (char *)Allocations::reallocate(data, capacity);
+				assert(newData);
+				data = newData;
+			}
+			const int bytesRead = gzread(fp, data + size, (unsigned)(capacity - size));
+			if (bytesRead < 0) {
+				int err = 0;
+				mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: failed to read data (%s)", gzerror(fp, &err));
+				return false;
+			}
+			if (bytesRead == 0) {
+				return true;
+			}
+			size += (size_t)bytesRead;
+		}
+	}
+
 	bool readHeader() {
-		Uint32 fileFormatTag;
-		size_t read = fread(&fileFormatTag, sizeof(fileFormatTag), 1, fp);
-		if (read != 1) {
-			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: failed to read format tag (%d)", errno);
+		Uint32 fileFormatTag = 0;
+		if (!read(&fileFormatTag, sizeof(fileFormatTag))) {
 			return false;
 		}
 
@@ -409,24 +967,66 @@ private:
 	}
 
 	void readStringInternal(String & v) {
-		Uint32 len;
-		size_t read = fread(&len, sizeof(len), 1, fp);
-		assert(read == 1);
+		Uint32 len = 0;
+		read(&len, sizeof(len));
+		if (len > getRemaining()) {
+			fail(len);
+			len = 0;
+		}
 
 		if (len) {
 			v.alloc(len);
-			read = fread(&v[0u], sizeof(char), len, fp);
-			assert(read == len);
+			read(&v[0u], len);
+			v[len - 1] = '\0';
+		} else {
+			v.assign("");
 		}
 	}
 
-	FILE* fp;
+	size_t getRemaining() const {
+		return size - pos;
+	}
+
+	// copy bytes out of the file data. past the end of the data, zeroes are read instead
+	// @param dest where to copy the bytes
+	// @param bytes the number of bytes
+	// @return true if the bytes were read
+	bool read(void * dest, size_t bytes) {
+		if (bytes == 0) {
+			return !failed;
+		}
+		if (failed || bytes > getRemaining()) {
+			fail(bytes);
+			memset(dest, 0, bytes);
+			return false;
+		}
+		memcpy(dest, data + pos, bytes);
+		pos += bytes;
+		return true;
+	}
+
+	// stop reading, reporting the first error only
+	// @param bytes the number of bytes that were wanted
+	void fail(size_t bytes) {
+		if (!failed) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "BinaryFileReader: unexpected end of file (wanted %llu bytes at %llu of %llu)",
+				(unsigned long long)bytes, (unsigned long long)pos, (unsigned long long)size);
+			failed = true;
+		}
+		pos = size;
+	}
+
+	gzFile fp;
+	char* data = nullptr;
+	size_t size = 0;
+	size_t pos = 0;
+	bool failed = false;
 };
 
-static EFileFormat GetFileFormat(FILE * file) {
+static EFileFormat GetFileFormat(gzFile file) {
 	Uint32 fileFormatTag = 0;
-	fread(&fileFormatTag, sizeof(fileFormatTag), 1, file);
-	fseek(file, 0, SEEK_SET);
+	gzread(file, &fileFormatTag, sizeof(fileFormatTag));
+	gzrewind(file);
 
 	if (fileFormatTag == BinaryFormatTag) {
 		return EFileFormat::Binary;
@@ -436,13 +1036,17 @@ static EFileFormat GetFileFormat(FILE * file) {
 	}
 }
 
-bool FileHelper::writeObjectInternal(const char * filename, EFileFormat format, const SerializationFunc& serialize) {
-	FILE * file = nullptr;
-	errno_t err = fopen_s(&file, filename, "wb");
-	if (!file || err) {
+bool FileHelper::writeObjectInternal(const char * filename, EFileFormat format, int compression, const SerializationFunc& serialize) {
+	ALLOC_SCOPE(TAG_IO);
+	// "T" writes straight through, without a gzip header
+	assert(compression >= 0 && compression <= 9);
+	char mode[4] = { 'w', 'b', compression > 0 ? (char)('0' + compression) : 'T', '\0' };
+	gzFile file = gzopen(filename, mode);
+	if (!file) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "Unable to open file '%s' for write (%d)", filename, errno);
 		return false;
 	}
+	gzbuffer(file, ioBufferSize);
 
 	bool success = false;
 	if (format == EFileFormat::Binary) {
@@ -455,18 +1059,23 @@ bool FileHelper::writeObjectInternal(const char * filename, EFileFormat format,
 		assert(false);
 	}
 
-	fclose(file);
+	if (gzclose(file) != Z_OK) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "Unable to finish writing file '%s'", filename);
+		success = false;
+	}
 
 	return success;
 }
 
 bool FileHelper::readObjectInternal(const char * filename, const SerializationFunc& serialize) {
-	FILE * file = nullptr;
-	errno_t err = fopen_s(&file, filename, "rb");
-	if (!file || err) {
+	ALLOC_SCOPE(TAG_IO);
+	// compressed files are recognized by their gzip header, anything else is read as it is
+	gzFile file = gzopen(filename, "rb");
+	if (!file) {
 		mainEngine->fmsg(Engine::MSG_ERROR, "Unable to open file '%s' for read (%d)", filename, errno);
 		return false;
 	}
+	gzbuffer(file, ioBufferSize);
 
 	EFileFormat format = GetFileFormat(file);
 
@@ -481,7 +1090,7 @@ bool FileHelper::readObjectInternal(const char * filename, const SerializationFu
 		assert(false);
 	}
 
-	fclose(file);
+	gzclose(file);
 
 	return success;
 }
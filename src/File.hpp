@@ -24,12 +24,19 @@
 #include "ArrayList.hpp"
 
 #include <functional>
+#include <type_traits>
 
 enum class EFileFormat {
 	Json,
 	Binary
 };
 
+// types whose bytes can be copied straight into a binary file, so arrays of them are written with a single copy
+// only specialize this for plain structs with no pointers, and bump the owner's version if the layout changes
+// eg. template<> struct IsRawSerializable<MyStruct> : std::true_type {};
+template<typename T>
+struct IsRawSerializable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+
 class FileInterface {
 public:
 	virtual ~FileInterface() {}
@@ -68,6 +75,12 @@ public:
 	// @param maxLength maximum length of the string allowed, 0 is no limit
 	virtual void value(String& v, Uint32 maxLength = 0) = 0;
 
+	// Serializes a block of raw bytes in one go, if the format supports it
+	// @param data the bytes to serialize
+	// @param size the number of bytes
+	// @return true if the block was serialized, false if it has to be done a value at a time
+	virtual bool rawBlock(void* data, size_t size) { return false; }
+
 	// Serialize an ArrayList with a max length
 	// @param v the value to serialize
 	// @param maxLength maximum number of items, 0 is no limit
@@ -77,8 +90,10 @@ public:
 		beginArray(size);
 		assert(maxLength == 0 || size <= maxLength);
 		v.resize(size);
-		for (Uint32 index = 0; index < size; ++index) {
-			value(v[index], args...);
+		if (!valueRaw(v.getArray(), size, args...)) {
+			for (Uint32 index = 0; index < size; ++index) {
+				value(v[index], args...);
+			}
 		}
 		endArray();
 	}
@@ -120,8 +135,10 @@ public:
 		Uint32 size = Size;
 		beginArray(size);
 		assert(size == Size);
-		for (Uint32 index = 0; index < size; ++index) {
-			value(v[index], args...);
+		if (!valueRaw(v, Size, args...)) {
+			for (Uint32 index = 0; index < size; ++index) {
+				value(v[index], args...);
+			}
 		}
 		endArray();
 	}
@@ -136,6 +153,19 @@ public:
 		value(v, args...);
 	}
 
+private:
+	// Serializes the items of an array as one raw block, when their type allows it
+	// @param v the first item
+	// @param size the number of items
+	// @param args additional args that would be passed to value(), which rule out a raw copy
+	// @return true if the items were serialized
+	template<typename T, typename... Args>
+	bool valueRaw(T* v, Uint32 size, Args ... args) {
+		if (!IsRawSerializable<T>::value || sizeof...(Args) > 0) {
+			return false;
+		}
+		return rawBlock(v, (size_t)size * sizeof(T));
+	}
 };
 
 class FileHelper {
@@ -143,14 +173,15 @@ public:
 	// Write an object's data to a file
 	// @param filename the name of the file to write
 	// @param v the object to write
+	// @param compression 0 to write the file as it is, or a zlib level (1 fastest - 9 smallest) to gzip it
 	template<typename T>
-	static bool writeObject(const char * filename, EFileFormat format, T & v) {
+	static bool writeObject(const char * filename, EFileFormat format, T & v, int compression = 0) {
 		using std::placeholders::_1;
 		SerializationFunc serialize = std::bind(&T::serialize, &v, _1);
-		return writeObjectInternal(filename, format, serialize);
+		return writeObjectInternal(filename, format, compression, serialize);
 	}
 
-	// Read an object's data from a file
+	// Read an object's data from a file, which may be compressed
 	// @param filename the name of the file to read
 	// @param v the object to populate with data
 	template<typename T>
@@ -164,6 +195,6 @@ public:
 
 private:
 
-	static bool writeObjectInternal(const char * filename, EFileFormat format, const SerializationFunc& serialize);
+	static bool writeObjectInternal(const char * filename, EFileFormat format, int compression, const SerializationFunc& serialize);
 	static bool readObjectInternal(const char * filename, const SerializationFunc& serialize);
 };
@@ -5,61 +5,139 @@
 #include "Engine.hpp"
 #include "Renderer.hpp"
 #include "AI.hpp"
-
-bool intersectRayLine(const Vector& rayOrigin, const float rayAngle, const Vector& lineStart, const Vector& lineEnd, Vector& out) {
-	Vector r1 = rayOrigin;
-	r1.x += cosf(rayAngle);
-	r1.y += sinf(rayAngle);
-
-	Vector l = Vector(lineStart.x, lineStart.y, 1.f).cross(Vector(lineEnd.x, lineEnd.y, 1.f));
-	Vector m = Vector(rayOrigin.x, rayOrigin.y, 1.f).cross(Vector(r1.x, r1.y, 1.f));
-	Vector i = l.cross(m);
-
-	if (i.z == 0.f) {
-		out = rayOrigin;
+#include "Profiler.hpp"
+#include "Allocations.hpp"
+
+// returns true if two circles touch at any point while moving in a straight line
+// rel is the first circle's position relative to the second at the start of the move
+// motion is the first circle's motion relative to the second over the move
+bool sweepCircles(const Vector& rel, const Vector& motion, const float radii) {
+	float c = rel.lengthSquared() - radii * radii;
+	if (c <= 0.f) {
 		return true;
-	} else {
-		Vector q(i.x / i.z, i.y / i.z, 0.f);
-		Vector d(lineEnd - lineStart);
-		Vector o(q - lineStart);
-		if (d.lengthSquared() < o.lengthSquared() || d.dot(o) < 0.f || (q - rayOrigin).dot(r1 - rayOrigin) < 0.f) {
-			return false;
-		} else {
-			out = q;
-			return true;
-		}
 	}
+	float a = motion.lengthSquared();
+	if (a == 0.f) {
+		return false;
+	}
+	float b = rel.dot(motion);
+	float t = std::min(std::max(-b / a, 0.f), 1.f);
+	return c + 2.f * b * t + a * t * t <= 0.f;
 }
 
-int intersectRayCircle(const Vector& rayOrigin, const float rayAngle, const Vector& circleOrigin, const float radius, Vector& out1, Vector& out2) {
-	Vector r1;
-	r1.x += cosf(rayAngle);
-	r1.y += sinf(rayAngle);
+// returns true if a nonzero multiple of period lies within [ticks, ticks + step)
+bool crossesMultiple(const Uint32 ticks, const Uint32 step, const Uint32 period) {
+	Uint32 next = ((ticks + period - 1) / period) * period;
+	if (next == 0) {
+		next = period;
+	}
+	return next < ticks + step;
+}
 
-	Vector ac = circleOrigin - rayOrigin;
-	float ac1 = ac.dot(r1);
-	Vector ra = r1 * ac1;
-	Vector r = ra + rayOrigin;
+const Uint32 Game::maxStepTicks = 4;
+
+bool Game::testSweptCollisions() {
+	const int trials = 1000;
+	const Uint32 life = 48; // bullet lifetime in ticks, a multiple of every step length
+	const Uint32 contactTicks = 40; // every shot meets its asteroid well before this, so the lifetime never matters
+	const int samplesPerTick = 16; // for the finely sampled reference
+	const float bulletSpeed = 10.f;
+	const float bulletRadius = 2.f;
+	const float asteroidRadius = 10.f; // too small to split, so a hit leaves nothing behind
+	const float radii = bulletRadius + asteroidRadius;
+
+	// the same shots are replayed at every step length. each is one bullet and one asteroid in a game of their own,
+	// with the bullet first in the entity list for half of them and the asteroid first for the rest
+	struct Shot {
+		Vector bulletPos, bulletVel, asteroidPos, asteroidVel;
+		bool bulletFirst = true;
+	};
+	ArrayList<Shot> shots;
+	Random rand;
+	rand.seedValue(30);
+	for (int trial = 0; trial < trials; ++trial) {
+		const float ang = rand.getFloat() * PI * 2.f;
+		const float offset = (rand.getFloat() - 0.5f) * radii * 3.f;
+		const Vector heading(cosf(ang), sinf(ang), 0.f);
+		const Vector side(-heading.y, heading.x, 0.f);
+		Shot& shot = shots.emplace();
+		shot.bulletPos = side * offset - heading * 150.f;
+		shot.bulletVel = heading * bulletSpeed;
+		shot.asteroidVel = Vector(rand.getFloat() * 6.f - 3.f, rand.getFloat() * 6.f - 3.f, 0.f);
+		shot.bulletFirst = trial % 2 == 0;
+	}
 
-	if (ra.dot(r1) < 0.f) {
-		return 0;
+	// plain distance tests on the straight-line paths: once a tick, and many times a tick for shots that only graze
+	int tickHits = 0;
+	int fineHits = 0;
+	ArrayList<Uint8> tickHit;
+	ArrayList<Uint8> fineHit;
+	for (auto& shot : shots) {
+		bool hitTick = false;
+		bool hitFine = false;
+		for (Uint32 sample = 0; sample <= contactTicks * samplesPerTick; ++sample) {
+			const float t = (float)sample / samplesPerTick;
+			const Vector diff = (shot.bulletPos + shot.bulletVel * t) - (shot.asteroidPos + shot.asteroidVel * t);
+			const float dist = diff.length();
+			hitFine = hitFine || dist <= radii + 0.05f;
+			hitTick = hitTick || (sample % samplesPerTick == 0 && dist <= radii);
+		}
+		tickHit.push(hitTick ? 1 : 0);
+		fineHit.push(hitFine ? 1 : 0);
+		tickHits += hitTick ? 1 : 0;
+		fineHits += hitFine ? 1 : 0;
 	}
 
-	float dist = (r - circleOrigin).length();
-	float a = asinf(dist / radius);
-	float c = cosf(a) * radius;
+	// now fire them for real. every shot the tick test hits must hit, and nothing the fine test misses may
+	int reference = 0;
+	bool passed = true;
+	for (Uint32 step = 1; step <= maxStepTicks; ++step) {
+		Game game(nullptr, 2000.f, 2000.f);
+		game.setStepTicks(step);
+		int hits = 0;
+		int missed = 0;
+		int extra = 0;
+		for (Uint32 c = 0; c < shots.getSize(); ++c) {
+			const Shot& shot = shots[c];
+			Bullet* bullet = new Bullet(&game);
+			bullet->pos = shot.bulletPos;
+			bullet->vel = shot.bulletVel;
+			bullet->life = (float)life;
+			bullet->radius = bulletRadius;
+			bullet->team = Entity::Team::TEAM_ALLY;
+			Asteroid* asteroid = new Asteroid(&game);
+			asteroid->pos = shot.asteroidPos;
+			asteroid->vel = shot.asteroidVel;
+			asteroid->radius = asteroidRadius;
+			asteroid->team = Entity::Team::TEAM_ENEMY;
+			if (shot.bulletFirst) {
+				game.addEntity(bullet);
+				game.addEntity(asteroid);
+			} else {
+				game.addEntity(asteroid);
+				game.addEntity(bullet);
+			}
 
-	if (dist == radius) {
-		out1 = r;
-		out2 = r;
-		return 1;
-	} else if (dist < radius) {
-		out1 = r - r1 * c;
-		out2 = r + r1 * c;
-		return 2;
-	} else {
-		return 0;
+			for (Uint32 ticks = 0; ticks < contactTicks && game.countType(Entity::Type::TYPE_ASTEROID); ticks += step) {
+				game.processEntities();
+			}
+			const bool hit = game.countType(Entity::Type::TYPE_ASTEROID) == 0;
+			hits += hit ? 1 : 0;
+			missed += !hit && tickHit[c] ? 1 : 0;
+			extra += hit && !fineHit[c] ? 1 : 0;
+			game.clearEntities();
+		}
+		if (step == 1) {
+			reference = hits;
+		}
+
+		const bool ok = missed == 0 && extra == 0 && std::abs(hits - reference) <= trials / 100;
+		mainEngine->fmsg(ok ? Engine::MSG_INFO : Engine::MSG_ERROR,
+			"collisions with %u-tick steps: %d / %d hits (%d with 1-tick steps, %d to %d by distance tests), %d missed, %d too many",
+			step, hits, trials, reference, tickHits, fineHits, missed, extra);
+		passed = passed && ok;
 	}
+	return passed;
 }
 
 Game::Game(AI* _ai, float _boardW, float _boardH) {
@@ -68,6 +146,7 @@ Game::Game(AI* _ai, float _boardW, float _boardH) {
 	boardH = _boardH;
 	//ticksPerSecond = mainEngine->getTicksPerSecond();
 	ticksPerSecond = 60;
+	setStepTicks(mainEngine->getStepTicks());
 }
 
 Game::~Game() {
@@ -75,7 +154,7 @@ Game::~Game() {
 }
 
 int Game::playSound(const char* filename, bool loop) {
-	if (!ai) {
+	if (!ai && mainEngine->isInitialized()) {
 		return mainEngine->playSound(filename, loop);
 	} else {
 		return 0;
@@ -83,7 +162,7 @@ int Game::playSound(const char* filename, bool loop) {
 }
 
 int Game::stopSound(int channel) {
-	if (!ai) {
+	if (!ai && mainEngine->isInitialized()) {
 		return mainEngine->stopSound(channel);
 	} else {
 		return 0;
@@ -97,14 +176,9 @@ void Game::init() {
 	gameInSession = true;
 }
 
-int Game::countAsteroids() {
-	int result = 0;
-	for (auto entity : entities) {
-		if (entity->team != Entity::Team::TEAM_ALLY) {
-			++result;
-		}
-	}
-	return result;
+int Game::countAsteroids() const {
+	// anything not on the player's team holds up the round, explosions included
+	return (int)(entities.getSize() - countTeam(Entity::Team::TEAM_ALLY));
 }
 
 void Game::spawnPlayer() {
@@ -112,7 +186,7 @@ void Game::spawnPlayer() {
 	player->ang = 3.f * PI / 2.f;
 	player->radius = 10.f;
 	player->team = Entity::Team::TEAM_ALLY;
-	entities.addNodeLast(player);
+	addEntity(player);
 }
 
 void Game::spawnAsteroids() {
@@ -127,18 +201,31 @@ void Game::spawnAsteroids() {
 			asteroid->pos.y += boardH / 2.f;
 		}
 		asteroid->team = Entity::Team::TEAM_ENEMY;
-		entities.addNodeLast(asteroid);
+		addEntity(asteroid);
 	}
 	beat = 70;
 	previousBeat = false;
 }
 
-void Game::term() {
+void Game::clearEntities() {
 	player = nullptr;
-	for (auto& entity : entities) {
+	Entity* next = nullptr;
+	for (Entity* entity = entities.getFirst(); entity != nullptr; entity = next) {
+		next = entities.getNext(entity);
+		entities.remove(entity);
+		freeHandle(entity->handle);
 		delete entity;
 	}
-	entities.removeAll();
+	for (int c = 0; c < (int)Entity::Type::TYPE_MAX; ++c) {
+		typeRegistry[c].clear();
+	}
+	for (int c = 0; c < (int)Entity::Team::TEAM_MAX; ++c) {
+		teamRegistry[c].clear();
+	}
+}
+
+void Game::term() {
+	clearEntities();
 
 	lossTimer = -1.f;
 	wonTimer = 0.f;
@@ -152,12 +239,33 @@ void Game::term() {
 	gameInSession = false;
 }
 
-void Game::draw(Camera& camera) {
+void Game::draw(Camera& camera, float alpha) {
+	PROFILE_SCOPE("Game::draw");
 	Renderer* renderer = mainEngine->getRenderer();
 	assert(renderer);
 
-	for (auto& entity : entities) {
+	for (auto entity : entities) {
+		if (alpha >= 1.f) {
+			entity->draw(camera);
+			continue;
+		}
+
+		Vector diff = stepMotion(entity);
+		float angDiff = fmod(entity->ang - entity->prevAng, PI * 2.f);
+		if (angDiff > PI) {
+			angDiff -= PI * 2.f;
+		} else if (angDiff < -PI) {
+			angDiff += PI * 2.f;
+		}
+
+		// draw at the interpolated pose, then put the real one back
+		Vector pos = entity->pos;
+		float ang = entity->ang;
+		entity->pos = entity->prevPos + diff * alpha;
+		entity->ang = entity->prevAng + angDiff * alpha;
 		entity->draw(camera);
+		entity->pos = pos;
+		entity->ang = ang;
 	}
 
 	// score
@@ -217,7 +325,7 @@ void Game::doKeyboardInput() {
 }
 
 void Game::doAI() {
-	float (&outputs)[3] = genome->outputs;
+	float (&outputs)[3] = genomeRun->outputs;
 	inputs[IN_THRUST] = outputs[0] > 0.f;
 	inputs[IN_RIGHT] = outputs[1] > 0.f;
 	inputs[IN_LEFT] = outputs[2] > 0.f;
@@ -229,71 +337,20 @@ void Game::process() {
 	if (!gameInSession) {
 		return;
 	}
+	PROFILE_SCOPE("Game::process");
+	ALLOC_SCOPE(TAG_GAME);
 	if (ai) {
 		doAI();
 	} else {
 		doKeyboardInput();
 	}
 
-	// process entities
-	Node<Entity*>* nextnode = nullptr;
-	for (Node<Entity*>* node = entities.getFirst(); node != nullptr; node = nextnode) {
-		nextnode = node->getNext();
-		Entity* entity = node->getData();
-
-		entity->process();
-
-		// wrap position
-		entity->pos.x += boardW / 2.f;
-		entity->pos.x = fmod(entity->pos.x, boardW);
-		if (entity->pos.x < 0.f) {
-			entity->pos.x += boardW;
-		}
-		entity->pos.x -= boardW / 2.f;
-
-		entity->pos.y += boardH / 2.f;
-		entity->pos.y = fmod(entity->pos.y, boardH);
-		if (entity->pos.y < 0.f) {
-			entity->pos.y += boardH;
-		}
-		entity->pos.y -= boardH / 2.f;
-
-		entity->pos.z = 0.f;
-		entity->ang = fmod(entity->ang, PI * 2.f);
-
-		// do collisions
-		for (Node<Entity*>* otherNode = nextnode; otherNode != nullptr; otherNode = otherNode->getNext()) {
-			if (entity->dead) {
-				break;
-			}
-			Entity* other = otherNode->getData();
-			if (entity->lastEntityHit == other || other->dead) {
-				continue;
-			}
-
-			float dist = (entity->pos - other->pos).lengthSquared();
-			float radii = (entity->radius + other->radius) * (entity->radius + other->radius);
-			if (dist <= radii) {
-				entity->onHit(other);
-				other->onHit(entity);
-			}
-		}
-
-		// remove dead entities
-		if (entity->dead) {
-			if (player == entity) {
-				player = nullptr;
-				lossTimer = 0.f;
-			}
-			delete entity;
-			entities.removeNode(node);
-		}
-	}
+	processEntities();
 
 	// end round timer
 	int numAsteroids = countAsteroids();
 	if (numAsteroids == 0) {
-		wonTimer += 1.f;
+		wonTimer += (float)stepTicks;
 		if (wonTimer > 120.f) {
 			++wins;
 			wonTimer = 0.f;
@@ -303,7 +360,7 @@ void Game::process() {
 		}
 	}
 	if (player == nullptr && lossTimer >= 0.f) {
-		lossTimer += 1.f;
+		lossTimer += (float)stepTicks;
 		if (lossTimer > 150.f) {
 			++losses;
 			lossTimer = -1.f;
@@ -317,7 +374,7 @@ void Game::process() {
 	// spawn aliens
 #define SPAWN_ALIENS
 #ifdef SPAWN_ALIENS
-	if (numAsteroids > 0 && ticks && ticks % (15 * ticksPerSecond) == 0 && rand.getUint8() % 2 == 0) {
+	if (numAsteroids > 0 && crossesMultiple(ticks, stepTicks, 15 * ticksPerSecond) && rand.getUint8() % 2 == 0) {
 		Alien* alien = new Alien(this);
 		bool right = rand.getUint8() % 2 == 0;
 		alien->pos.x = right ? boardW / 2.f : -boardW / 2.f;
@@ -336,22 +393,336 @@ void Game::process() {
 	if (beat < 20) {
 		beat = 20;
 	}
-	if (ticks && ticks % beat == 0) {
+	if (crossesMultiple(ticks, stepTicks, beat)) {
 		previousBeat = (previousBeat == false);
 		const char* path = previousBeat ? "sounds/beat.wav" : "sounds/beat2.wav";
 		playSound(path, false);
 	}
 
-	++ticks;
+	ticks += stepTicks;
+}
+
+void Game::processEntities() {
+	// move every entity first, so the collisions below all see the same moment
+	// entities added along the way (eg. bullets) are moved in the same pass
+	for (Entity* entity = entities.getFirst(); entity != nullptr; entity = entities.getNext(entity)) {
+		entity->prevPos = entity->pos;
+		entity->prevAng = entity->ang;
+		entity->process();
+
+		// wrap position
+		entity->pos.x += boardW / 2.f;
+		entity->pos.x = fmod(entity->pos.x, boardW);
+		if (entity->pos.x < 0.f) {
+			entity->pos.x += boardW;
+		}
+		entity->pos.x -= boardW / 2.f;
+
+		entity->pos.y += boardH / 2.f;
+		entity->pos.y = fmod(entity->pos.y, boardH);
+		if (entity->pos.y < 0.f) {
+			entity->pos.y += boardH;
+		}
+		entity->pos.y -= boardH / 2.f;
+
+		entity->pos.z = 0.f;
+		entity->ang = fmod(entity->ang, PI * 2.f);
+	}
+
+	// do collisions
+	// both entities are swept over the step that just happened, so fast bullets can't pass through things.
+	// anything spawned by a hit (eg. asteroid fragments) is added past the last moved entity, and waits for the next step
+	Entity* last = entities.getLast();
+	for (Entity* entity = entities.getFirst(); entity != nullptr; entity = entities.getNext(entity)) {
+		if (!entity->dead) {
+			const Vector motion = stepMotion(entity);
+			for (Entity* other = entities.getNext(entity); other != nullptr; other = entities.getNext(other)) {
+				if (entity->dead) {
+					break;
+				}
+				if (entity->lastEntityHit == other->handle || other->dead) {
+					continue;
+				}
+
+				Vector relMotion = motion - stepMotion(other);
+				Vector rel = (entity->pos - other->pos) - relMotion;
+				if (sweepCircles(rel, relMotion, entity->radius + other->radius)) {
+					entity->onHit(other);
+					other->onHit(entity);
+				}
+
+				if (other == last) {
+					break;
+				}
+			}
+		}
+		if (entity == last) {
+			break;
+		}
+	}
+
+	// remove dead entities
+	Entity* next = nullptr;
+	for (Entity* entity = entities.getFirst(); entity != nullptr; entity = next) {
+		next = entities.getNext(entity);
+		if (entity->dead) {
+			if (player == entity) {
+				player = nullptr;
+				lossTimer = 0.f;
+			}
+			unregisterEntity(entity);
+			freeHandle(entity->handle);
+			entities.remove(entity);
+			delete entity;
+		}
+	}
+}
+
+void Game::setStepTicks(Uint32 _stepTicks) {
+	stepTicks = std::min(std::max(_stepTicks, (Uint32)1), maxStepTicks);
+}
+
+float Game::wrapRay(Vector& origin, const Vector& dir) const {
+	const float halfW = boardW / 2.f;
+	const float halfH = boardH / 2.f;
+
+	// find where the ray leaves the board
+	const float tx = dir.x > 0.f ? (halfW - origin.x) / dir.x : (dir.x < 0.f ? (-halfW - origin.x) / dir.x : FLT_MAX);
+	const float ty = dir.y > 0.f ? (halfH - origin.y) / dir.y : (dir.y < 0.f ? (-halfH - origin.y) / dir.y : FLT_MAX);
+	const float t = std::max(std::min(tx, ty), 0.f);
+
+	// and carry on from the opposite edge
+	origin.x += dir.x * t;
+	origin.y += dir.y * t;
+	if (tx <= ty) {
+		origin.x = dir.x > 0.f ? -halfW : halfW;
+	}
+	if (ty <= tx) {
+		origin.y = dir.y > 0.f ? -halfH : halfH;
+	}
+	return t;
+}
+
+Vector Game::stepMotion(const Entity* entity) const {
+	return shortestOffset(entity->prevPos, entity->pos);
+}
+
+Vector Game::shortestOffset(const Vector& from, const Vector& to) const {
+	Vector diff = to - from;
+	if (diff.x > boardW / 2.f) {
+		diff.x -= boardW;
+	} else if (diff.x < -boardW / 2.f) {
+		diff.x += boardW;
+	}
+	if (diff.y > boardH / 2.f) {
+		diff.y -= boardH;
+	} else if (diff.y < -boardH / 2.f) {
+		diff.y += boardH;
+	}
+	return diff;
 }
 
 void Game::addEntity(Entity* entity) {
-	entities.addNodeLast(entity);
+	entity->handle = allocHandle(entity);
+	entity->prevPos = entity->pos;
+	entity->prevAng = entity->ang;
+	registerEntity(entity);
+	entities.addLast(entity);
+}
+
+void Game::registerEntity(Entity* entity) {
+	auto& byType = typeRegistry[(int)entity->getType()];
+	entity->typeSlot = (Uint32)byType.getSize();
+	byType.push(entity);
+
+	auto& byTeam = teamRegistry[(int)entity->team];
+	entity->teamSlot = (Uint32)byTeam.getSize();
+	byTeam.push(entity);
+}
+
+void Game::unregisterEntity(Entity* entity) {
+	// remove() moves the last element into the hole, so fix up its slot
+	auto& byType = typeRegistry[(int)entity->getType()];
+	assert(byType[entity->typeSlot] == entity);
+	byType.remove(entity->typeSlot);
+	if (entity->typeSlot < byType.getSize()) {
+		byType[entity->typeSlot]->typeSlot = entity->typeSlot;
+	}
+
+	auto& byTeam = teamRegistry[(int)entity->team];
+	assert(byTeam[entity->teamSlot] == entity);
+	byTeam.remove(entity->teamSlot);
+	if (entity->teamSlot < byTeam.getSize()) {
+		byTeam[entity->teamSlot]->teamSlot = entity->teamSlot;
+	}
+}
+
+Entity* Game::getEntity(const EntityHandle& handle) const {
+	if (handle.index >= slots.getSize()) {
+		return nullptr;
+	}
+	const Slot& slot = slots[handle.index];
+	return slot.generation == handle.generation ? slot.entity : nullptr;
+}
+
+EntityHandle Game::allocHandle(Entity* entity) {
+	EntityHandle handle;
+	if (freeSlots.getSize()) {
+		handle.index = freeSlots.pop();
+	} else {
+		handle.index = (Uint32)slots.getSize();
+		slots.push(Slot());
+	}
+	Slot& slot = slots[handle.index];
+	slot.entity = entity;
+	handle.generation = slot.generation;
+	return handle;
+}
+
+void Game::freeHandle(const EntityHandle& handle) {
+	if (getEntity(handle) == nullptr) {
+		return;
+	}
+	Slot& slot = slots[handle.index];
+	slot.entity = nullptr;
+	++slot.generation;
+	if (slot.generation == 0) {
+		slot.generation = 1;
+	}
+	freeSlots.push(handle.index);
+}
+
+Entity* Game::createEntity(Entity::Type type) {
+	switch (type) {
+	case Entity::Type::TYPE_PLAYER: return new Player(this);
+	case Entity::Type::TYPE_ASTEROID: return new Asteroid(this);
+	case Entity::Type::TYPE_ALIEN: return new Alien(this);
+	case Entity::Type::TYPE_BULLET: return new Bullet(this);
+	case Entity::Type::TYPE_EXPLOSION: return new Explosion(this);
+	default: return nullptr;
+	}
+}
+
+void Game::snapshot(GameSnapshot& dest) const {
+	dest.wins = wins;
+	dest.losses = losses;
+	dest.boardW = boardW;
+	dest.boardH = boardH;
+	dest.wonTimer = wonTimer;
+	dest.lossTimer = lossTimer;
+	dest.beat = beat;
+	dest.previousBeat = previousBeat;
+	dest.score = score;
+	dest.lives = lives;
+	dest.ticks = ticks;
+	dest.stepTicks = stepTicks;
+	dest.ticksPerSecond = ticksPerSecond;
+	dest.gameInSession = gameInSession;
+	for (int c = 0; c < IN_MAX; ++c) {
+		dest.inputs[c] = inputs[c];
+	}
+	dest.inputCount = inputCount;
+	dest.player = player ? player->handle : EntityHandle();
+	dest.rand = rand;
+
+	dest.generations.resize(slots.getSize());
+	for (size_t c = 0; c < slots.getSize(); ++c) {
+		dest.generations[c] = slots[c].generation;
+	}
+	dest.freeSlots.copy(freeSlots);
+
+	dest.entities.resize(entities.getSize());
+	size_t index = 0;
+	for (auto entity : entities) {
+		entity->save(dest.entities[index]);
+		++index;
+	}
+	dest.valid = true;
+}
+
+void Game::restore(const GameSnapshot& src) {
+	assert(src.isValid());
+	clearEntities();
+
+	wins = src.wins;
+	losses = src.losses;
+	boardW = src.boardW;
+	boardH = src.boardH;
+	wonTimer = src.wonTimer;
+	lossTimer = src.lossTimer;
+	beat = src.beat;
+	previousBeat = src.previousBeat;
+	score = src.score;
+	lives = src.lives;
+	ticks = src.ticks;
+	stepTicks = src.stepTicks;
+	ticksPerSecond = src.ticksPerSecond;
+	gameInSession = src.gameInSession;
+	for (int c = 0; c < IN_MAX; ++c) {
+		inputs[c] = src.inputs[c];
+	}
+	inputCount = src.inputCount;
+	rand = src.rand;
+
+	// restore the handle table exactly, so stored handles stay valid (or stale)
+	slots.resize(src.generations.getSize());
+	for (size_t c = 0; c < slots.getSize(); ++c) {
+		slots[c].entity = nullptr;
+		slots[c].generation = src.generations[c];
+	}
+	freeSlots.copy(src.freeSlots);
+
+	for (auto& record : src.entities) {
+		Entity* entity = createEntity(record.type);
+		assert(entity);
+		entity->load(record);
+		assert(entity->handle.index < slots.getSize());
+		slots[entity->handle.index].entity = entity;
+		registerEntity(entity);
+		entities.addLast(entity);
+	}
+	player = static_cast<Player*>(getEntity(src.player));
+}
+
+void Entity::save(Record& record) const {
+	record.type = getType();
+	record.team = team;
+	record.handle = handle;
+	record.lastEntityHit = lastEntityHit;
+	record.parent = EntityHandle();
+	record.pos[0] = pos.x;
+	record.pos[1] = pos.y;
+	record.vel[0] = vel.x;
+	record.vel[1] = vel.y;
+	record.ang = ang;
+	record.radius = radius;
+	record.life = life;
+	record.ticks = ticks;
+	record.shotsFired = shotsFired;
+	record.shotsHit = shotsHit;
+	record.dead = dead;
+}
+
+void Entity::load(const Record& record) {
+	team = record.team;
+	handle = record.handle;
+	lastEntityHit = record.lastEntityHit;
+	pos = Vector(record.pos[0], record.pos[1], 0.f);
+	vel = Vector(record.vel[0], record.vel[1], 0.f);
+	ang = record.ang;
+	prevPos = pos;
+	prevAng = ang;
+	radius = record.radius;
+	life = record.life;
+	ticks = record.ticks;
+	shotsFired = record.shotsFired;
+	shotsHit = record.shotsHit;
+	dead = record.dead;
 }
 
 void Entity::process() {
-	pos += vel;
-	++ticks;
+	pos += vel * (float)game->stepTicks;
+	ticks += game->stepTicks;
 }
 
 bool Entity::onHit(const Entity* other) {
@@ -366,8 +737,9 @@ bool Entity::onHit(const Entity* other) {
 			(game->player != other || other->ticks >= Player::shieldTime)) {
 			if (team == Team::TEAM_ENEMY && other->getType() == Type::TYPE_BULLET) {
 				auto bullet = static_cast<const Bullet*>(other);
-				if (bullet->parent) {
-					++bullet->parent->shotsHit;
+				Entity* parent = game->getEntity(bullet->parent);
+				if (parent) {
+					++parent->shotsHit;
 				}
 				game->score += getPoints();
 				game->beat -= 2;
@@ -378,7 +750,7 @@ bool Entity::onHit(const Entity* other) {
 			return false;
 		}
 	}
-	lastEntityHit = other;
+	lastEntityHit = other->handle;
 	return false;
 }
 
@@ -390,85 +762,11 @@ void Entity::shootBullet(float speed, float range) {
 	bullet->life = range;
 	bullet->team = team;
 	bullet->radius = 2.f;
-	bullet->parent = this;
+	bullet->parent = handle;
 	game->addEntity(bullet);
 	++shotsFired;
 }
 
-OrderedPair<Entity*, float> Entity::rayTrace(Vector origin, float angle, int disableSide, int count) {
-	OrderedPair<Entity*, float> result;
-	result.a = nullptr;
-	result.b = FLT_MAX;
-	Vector intersect;
-
-	// test against entities
-	for (auto entity : game->entities) {
-		if (entity == this || entity->team == Team::TEAM_NONE || entity->team == team) {
-			continue;
-		}
-		Vector intersect1, intersect2;
-		int num = intersectRayCircle(origin, angle, entity->pos, entity->radius, intersect1, intersect2);
-		if (num) {
-			result.a = entity;
-			result.b = std::min(result.b, (origin - intersect1).length());
-		}
-	}
-
-	// test against edge of board
-	if (result.a == nullptr && count < 2) {
-		if (disableSide != 1) { // top
-			Vector start(-game->boardW / 2.f, -game->boardH / 2.f, 0.f);
-			Vector   end(game->boardW / 2.f, -game->boardH / 2.f, 0.f);
-			if (intersectRayLine(origin, angle, start, end, intersect)) {
-				result = rayTrace(Vector(intersect.x, -intersect.y, 0.f), angle, 2, count + 1);
-				if (result.a != nullptr) {
-					float distToEdge = (intersect - origin).length();
-					result.b += distToEdge;
-					return result;
-				}
-			}
-		}
-		if (disableSide != 2) { // bottom
-			Vector start(-game->boardW / 2.f, game->boardH / 2.f, 0.f);
-			Vector   end(game->boardW / 2.f, game->boardH / 2.f, 0.f);
-			if (intersectRayLine(origin, angle, start, end, intersect)) {
-				result = rayTrace(Vector(intersect.x, -intersect.y, 0.f), angle, 1, count + 1);
-				if (result.a != nullptr) {
-					float distToEdge = (intersect - origin).length();
-					result.b += distToEdge;
-					return result;
-				}
-			}
-		}
-		if (disableSide != 3) { // left
-			Vector start(-game->boardW / 2.f, -game->boardH / 2.f, 0.f);
-			Vector   end(-game->boardW / 2.f, game->boardH / 2.f, 0.f);
-			if (intersectRayLine(origin, angle, start, end, intersect)) {
-				result = rayTrace(Vector(-intersect.x, intersect.y, 0.f), angle, 4, count + 1);
-				if (result.a != nullptr) {
-					float distToEdge = (intersect - origin).length();
-					result.b += distToEdge;
-					return result;
-				}
-			}
-		}
-		if (disableSide != 4) { // right
-			Vector start(game->boardW / 2.f, -game->boardH / 2.f, 0.f);
-			Vector   end(game->boardW / 2.f, game->boardH / 2.f, 0.f);
-			if (intersectRayLine(origin, angle, start, end, intersect)) {
-				result = rayTrace(Vector(-intersect.x, intersect.y, 0.f), angle, 3, count + 1);
-				if (result.a != nullptr) {
-					float distToEdge = (intersect - origin).length();
-					result.b += distToEdge;
-					return result;
-				}
-			}
-		}
-	}
-
-	return result;
-}
-
 const float Player::shieldTime = 0.f;
 
 void Player::process() {
@@ -477,26 +775,24 @@ void Player::process() {
 	// velocity dampening
 	//vel = vel * 0.8f;
 
-	int bullets = 0;
-	for (auto entity : game->entities) {
-		if (entity->team == Team::TEAM_ALLY && entity != game->player) {
-			++bullets;
-		}
+	Uint32 bullets = game->countTeam(Team::TEAM_ALLY);
+	if (game->player && game->player->team == Team::TEAM_ALLY) {
+		--bullets;
 	}
 	if (bullets == 0 && vel.lengthSquared() == 0.f) {
 		moved = false;
 	}
 
 	if (game->inputs[Game::Input::IN_RIGHT]) {
-		ang += (PI / game->ticksPerSecond);
+		ang += (PI / game->ticksPerSecond) * game->stepTicks;
 		moved = true;
 	}
 	if (game->inputs[Game::Input::IN_LEFT]) {
-		ang -= (PI / game->ticksPerSecond);
+		ang -= (PI / game->ticksPerSecond) * game->stepTicks;
 		moved = true;
 	}
 	if (game->inputs[Game::Input::IN_THRUST]) {
-		vel += (front * 10.f) / game->ticksPerSecond;
+		vel += (front * 10.f * (float)game->stepTicks) / game->ticksPerSecond;
 		moved = true;
 	}
 	if (game->inputs[Game::Input::IN_SHOOT]) {
@@ -568,6 +864,20 @@ bool Player::onHit(const Entity* other) {
 	return false;
 }
 
+void Player::save(Record& record) const {
+	Entity::save(record);
+	record.shootTime = shootTime;
+	record.moved = moved;
+	record.shooting = shooting;
+}
+
+void Player::load(const Record& record) {
+	Entity::load(record);
+	shootTime = record.shootTime;
+	moved = record.moved;
+	shooting = record.shooting;
+}
+
 void Asteroid::process() {
 	Entity::process();
 }
@@ -649,7 +959,7 @@ void Alien::process() {
 	}
 
 	// die eventually
-	life -= 1.f;
+	life -= (float)game->stepTicks;
 	if (life <= 0.f) {
 		dead = true;
 	}
@@ -667,6 +977,17 @@ bool Alien::onHit(const Entity* other) {
 	return false;
 }
 
+void Alien::save(Record& record) const {
+	Entity::save(record);
+	record.state = static_cast<Uint32>(state);
+}
+
+void Alien::load(const Record& record) {
+	Entity::load(record);
+	state = static_cast<State>(record.state);
+	channel = -1; // sound channels belong to the original game
+}
+
 void Alien::draw(Camera& camera) {
 	Vector src, dest;
 	static const WideVector color(1.f, 0.f, 0.f, 1.f);
@@ -714,12 +1035,22 @@ void Alien::draw(Camera& camera) {
 
 void Bullet::process() {
 	Entity::process();
-	life -= 1.f;
+	life -= (float)game->stepTicks;
 	if (life <= 0.f) {
 		dead = true;
 	}
 }
 
+void Bullet::save(Record& record) const {
+	Entity::save(record);
+	record.parent = parent;
+}
+
+void Bullet::load(const Record& record) {
+	Entity::load(record);
+	parent = record.parent;
+}
+
 void Bullet::draw(Camera& camera) {
 	Rect<int> dest;
 	dest.x = pos.x - 2 + game->boardW / 2.f;
@@ -740,7 +1071,7 @@ void Explosion::process() {
 	} else {
 		radius = 25.f - (ticks - 25.f);
 	}
-	life += 1.f;
+	life += (float)game->stepTicks;
 	if (life >= 50.f) {
 		dead = true;
 	}
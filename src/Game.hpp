@@ -4,15 +4,35 @@
 
 #include "Main.hpp"
 #include "Vector.hpp"
-#include "LinkedList.hpp"
+#include "IntrusiveList.hpp"
+#include "ArrayList.hpp"
 #include "Camera.hpp"
 #include "Random.hpp"
 #include "Pair.hpp"
 
-class Genome;
+class GenomeRun;
 class Game;
+class GameSnapshot;
 class AI;
 
+// stable reference to an entity, checked for validity in O(1) through Game::getEntity()
+// the slot index may be reused once the entity is removed, but never with the same generation
+struct EntityHandle {
+	Uint32 index = 0;
+	Uint32 generation = 0; // zero is never a live generation
+
+	// @return true if the handle was never assigned to an entity
+	bool isNull() const { return generation == 0; }
+
+	bool operator==(const EntityHandle& src) const {
+		return index == src.index && generation == src.generation;
+	}
+
+	bool operator!=(const EntityHandle& src) const {
+		return index != src.index || generation != src.generation;
+	}
+};
+
 class Entity {
 public:
 	Entity(Game* _game) : game(_game) {}
@@ -24,7 +44,8 @@ public:
 		TYPE_ASTEROID,
 		TYPE_ALIEN,
 		TYPE_BULLET,
-		TYPE_EXPLOSION
+		TYPE_EXPLOSION,
+		TYPE_MAX
 	};
 
 	// team
@@ -54,18 +75,54 @@ public:
 	// shoot a bullet
 	void shootBullet(float speed, float range);
 
-	// ray trace the given angle, returning distance to the closest obstacle
-	OrderedPair<Entity*, float> rayTrace(Vector origin, float angle, int disableSide = 0, int count = 0);
+	// number of board edges a ray trace may wrap across
+	static const int maxRayWraps = 2;
+
+	// flat copy of an entity
+	struct Record {
+		Type type = Type::TYPE_EXPLOSION;
+		Team team = Team::TEAM_NONE;
+		EntityHandle handle;
+		EntityHandle lastEntityHit;
+		EntityHandle parent;
+		float pos[2] = { 0.f, 0.f };
+		float vel[2] = { 0.f, 0.f };
+		float ang = 0.f;
+		float radius = 0.f;
+		float life = 0.f;
+		Uint32 ticks = 0;
+		int shotsFired = 0;
+		int shotsHit = 0;
+		Uint32 shootTime = 0;
+		Uint32 state = 0;
+		bool moved = false;
+		bool shooting = false;
+		bool dead = false;
+	};
+
+	// copy entity state into a record
+	// @param record the record to fill
+	virtual void save(Record& record) const;
+
+	// copy entity state out of a record
+	// @param record the record to read
+	virtual void load(const Record& record);
 
 	Vector pos;
 	Vector vel;
 	float ang = 0.f;
+	Vector prevPos; // pos before the last step, for render interpolation
+	float prevAng = 0.f; // ang before the last step, for render interpolation
 	float radius = 0.f;
 	float life = 0.f;
 	Uint32 ticks = 0;
 	Team team = Team::TEAM_NONE;
 	bool dead = false;
-	const Entity* lastEntityHit = nullptr;
+	EntityHandle handle;
+	EntityHandle lastEntityHit;
+	Uint32 typeSlot = 0; // position in Game's type registry
+	Uint32 teamSlot = 0; // position in Game's team registry
+	IntrusiveLink<Entity> gameLink; // links in Game's entity list
 	Game* game = nullptr;
 	int shotsFired = 4;
 	int shotsHit = 1;
@@ -88,6 +145,9 @@ public:
 
 	virtual bool onHit(const Entity* other) override;
 
+	virtual void save(Record& record) const override;
+	virtual void load(const Record& record) override;
+
 	Uint32 shootTime = 0;
 
 	bool moved = false;
@@ -135,6 +195,9 @@ public:
 
 	virtual bool onHit(const Entity* other) override;
 
+	virtual void save(Record& record) const override;
+	virtual void load(const Record& record) override;
+
 	enum class State {
 		GO_DIAGONAL,
 		GO_STRAIGHT
@@ -162,7 +225,10 @@ public:
 	// @param camera The camera to draw with
 	virtual void draw(Camera& camera) override;
 
-	Entity* parent = nullptr;
+	virtual void save(Record& record) const override;
+	virtual void load(const Record& record) override;
+
+	EntityHandle parent;
 };
 
 class Explosion : public Entity {
@@ -190,7 +256,7 @@ public:
 	void init();
 
 	// count asteroids
-	int countAsteroids();
+	int countAsteroids() const;
 
 	// spawn asteroids
 	void spawnAsteroids();
@@ -216,13 +282,74 @@ public:
 	// process a frame
 	void process();
 
+	// largest number of ticks a single call to process() may cover
+	static const Uint32 maxStepTicks;
+
+	// fire real bullets at moving asteroids in a game at every step length, and check the hits against
+	// distance tests along their paths and against the game stepping one tick at a time. the hit counts are logged
+	// @return true if every step length hit what it should have
+	static bool testSweptCollisions();
+
+	// move a ray origin to where the ray leaves the board, then across to the opposite edge
+	// @param origin the start of the ray, moved to where it re-enters the board
+	// @param dir the unit direction of the ray
+	// @return the distance from the old origin to the edge it left through
+	float wrapRay(Vector& origin, const Vector& dir) const;
+
+	// @param from the start point
+	// @param to the end point
+	// @return the offset from one point to the other, taking the short way across board edges
+	Vector shortestOffset(const Vector& from, const Vector& to) const;
+
+	// set how many ticks each call to process() covers
+	// @param _stepTicks the new step length, clamped to 1 - maxStepTicks
+	void setStepTicks(Uint32 _stepTicks);
+
 	// draw a frame
-	void draw(Camera& camera);
+	// @param camera the camera to draw with
+	// @param alpha how far between the previous and current step to draw entities (0-1)
+	void draw(Camera& camera, float alpha = 1.f);
 
 	// add entity to gamestate
+	// the entity's team must be set before it is added
 	void addEntity(Entity* entity);
 
-	LinkedList<Entity*> entities;
+	// @param type the type to count
+	// @return the number of entities of the given type
+	Uint32 countType(Entity::Type type) const { return (Uint32)typeRegistry[(int)type].getSize(); }
+
+	// @param team the team to count
+	// @return the number of entities on the given team
+	Uint32 countTeam(Entity::Team team) const { return (Uint32)teamRegistry[(int)team].getSize(); }
+
+	// @param type the type to list
+	// @return every entity of the given type, in no particular order
+	const ArrayList<Entity*>& getEntitiesOfType(Entity::Type type) const { return typeRegistry[(int)type]; }
+
+	// @param team the team to list
+	// @return every entity on the given team, in no particular order
+	const ArrayList<Entity*>& getEntitiesOfTeam(Entity::Team team) const { return teamRegistry[(int)team]; }
+
+	// find the entity that a handle refers to
+	// @param handle the handle to look up
+	// @return the entity, or nullptr if it has been removed from the game
+	Entity* getEntity(const EntityHandle& handle) const;
+
+	// create an empty entity of the given type
+	// @param type the type of entity to create
+	// @return the new entity (not yet added to the game)
+	Entity* createEntity(Entity::Type type);
+
+	// copy the complete game state into a snapshot
+	// @param dest the snapshot to fill (its buffers are reused)
+	void snapshot(GameSnapshot& dest) const;
+
+	// replace the game state with the contents of a snapshot
+	// the ai and genome bindings of this game are left untouched
+	// @param src the snapshot to restore
+	void restore(const GameSnapshot& src);
+
+	IntrusiveList<Entity, &Entity::gameLink> entities;
 	Player* player = nullptr;
 
 	// inputs
@@ -246,11 +373,84 @@ public:
 	Uint32 score = 0;
 	Uint32 lives = 3;
 	Uint32 ticks = 0;
+	Uint32 stepTicks = 1; // ticks covered by each call to process(), always divides ticksPerSecond
 	Random rand;
 	int ticksPerSecond = 0;
 	bool gameInSession = false;
 
 	AI* ai = nullptr;
-	Genome* genome = nullptr;
+	GenomeRun* genomeRun = nullptr;
+	long inputCount = 0;
+
+private:
+	// entity handle table
+	struct Slot {
+		Entity* entity = nullptr;
+		Uint32 generation = 1;
+	};
+	ArrayList<Slot> slots;
+	ArrayList<Uint32> freeSlots;
+
+	// entities grouped by type and team, kept up to date on add/remove
+	ArrayList<Entity*> typeRegistry[(int)Entity::Type::TYPE_MAX];
+	ArrayList<Entity*> teamRegistry[(int)Entity::Team::TEAM_MAX];
+
+	// add an entity to the type and team registries
+	// @param entity the entity to add
+	void registerEntity(Entity* entity);
+
+	// remove an entity from the type and team registries
+	// @param entity the entity to remove
+	void unregisterEntity(Entity* entity);
+
+	// assign a handle to an entity
+	// @param entity the entity to assign a handle to
+	// @return the new handle
+	EntityHandle allocHandle(Entity* entity);
+
+	// invalidate a handle so its slot can be reused
+	// @param handle the handle to invalidate
+	void freeHandle(const EntityHandle& handle);
+
+	// delete all entities without touching the score or timers
+	void clearEntities();
+
+	// move every entity by one step, collide them, then remove the dead ones
+	void processEntities();
+
+	// @param entity the entity to measure
+	// @return how far the entity moved in its last step, taking the short way across board edges
+	Vector stepMotion(const Entity* entity) const;
+};
+
+// a flat copy of a Game, restorable into any other Game
+class GameSnapshot {
+public:
+	GameSnapshot() {}
+
+	// @return true if this snapshot holds a game
+	bool isValid() const { return valid; }
+
+	int wins = 0;
+	int losses = 0;
+	float boardW = 0.f;
+	float boardH = 0.f;
+	float wonTimer = 0.f;
+	float lossTimer = -1.f;
+	Uint32 beat = 70;
+	bool previousBeat = false;
+	Uint32 score = 0;
+	Uint32 lives = 3;
+	Uint32 ticks = 0;
+	Uint32 stepTicks = 1;
+	int ticksPerSecond = 0;
+	bool gameInSession = false;
+	bool inputs[Game::IN_MAX];
 	long inputCount = 0;
+	EntityHandle player;
+	Random rand;
+	ArrayList<Entity::Record> entities;
+	ArrayList<Uint32> generations;
+	ArrayList<Uint32> freeSlots;
+	bool valid = false;
 };
\ No newline at end of file
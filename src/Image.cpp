@@ -9,6 +9,7 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "Image.hpp"
+#include "Counters.hpp"
 
 const GLfloat Image::positions[8] {
 	0.f, 0.f,
@@ -98,6 +99,7 @@ Image::Image(const char* _name) : Asset(_name) {
 
 	// unbind vertex array
 	glBindVertexArray(0);
+	Counters::add(Counters::BUFFER_UPLOADS, 4); // the texture and three buffers
 
 	loaded = true;
 }
@@ -161,6 +163,7 @@ void Image::drawColor( const Rect<int>* src, const Rect<int>& dest, const glm::v
 	// bind texture
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, texid);
+	Counters::add(Counters::TEXTURE_BINDS);
 
 	// upload uniform variables
 	glUniformMatrix4fv(shader.getUniformLocation("gView"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
@@ -193,4 +196,6 @@ void Image::drawColor( const Rect<int>* src, const Rect<int>& dest, const glm::v
 	// draw
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
 	glBindVertexArray(0);
+	Counters::add(Counters::BUFFER_UPLOADS, 2);
+	Counters::add(Counters::DRAW_IMAGE);
 }
\ No newline at end of file
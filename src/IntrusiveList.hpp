@@ -0,0 +1,182 @@
+// IntrusiveList.hpp
+// Doubly linked list whose links are stored in the elements themselves
+
+#pragma once
+
+#include "Main.hpp"
+
+template <typename T>
+class IntrusiveLink;
+
+template <typename T, IntrusiveLink<T> T::*link>
+class IntrusiveList;
+
+// the links an element needs to be in an IntrusiveList
+// an element may be in as many lists at once as it has links
+template <typename T>
+class IntrusiveLink {
+public:
+	IntrusiveLink() {}
+
+	// links are never copied with the element they belong to
+	IntrusiveLink(const IntrusiveLink&) {}
+	IntrusiveLink& operator=(const IntrusiveLink&) { return *this; }
+
+	// will NOT remove the element from its list
+	~IntrusiveLink() {
+		assert(!linked);
+	}
+
+	// getters & setters
+	T*				getNext() const						{ return next; }
+	T*				getPrev() const						{ return prev; }
+	bool			isLinked() const					{ return linked; }
+
+private:
+	template <typename U, IntrusiveLink<U> U::*>
+	friend class IntrusiveList;
+
+	T* next = nullptr;
+	T* prev = nullptr;
+	bool linked = false;
+};
+
+// a list of elements that carry their own links, so adding and removing never allocates
+// the list does not own its elements; removing one only unlinks it
+// @param T The element type
+// @param link The member of T holding its links for this list
+template <typename T, IntrusiveLink<T> T::*link>
+class IntrusiveList {
+public:
+	IntrusiveList() {}
+	~IntrusiveList() {
+		removeAll();
+	}
+
+	IntrusiveList(const IntrusiveList&) = delete;
+	IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+	// getters & setters
+	T*					getFirst() const				{ return first; }
+	T*					getLast() const					{ return last; }
+	size_t				getSize() const					{ return size; }
+
+	// @param elem An element in the list
+	// @return the element after the given one, or nullptr if it is the last
+	static T* getNext(const T* elem) {
+		return (elem->*link).next;
+	}
+
+	// @param elem An element in the list
+	// @return the element before the given one, or nullptr if it is the first
+	static T* getPrev(const T* elem) {
+		return (elem->*link).prev;
+	}
+
+	// adds an element to the beginning of the list
+	// @param elem The element to add, which must not already be in a list through this link
+	void addFirst(T* elem) {
+		IntrusiveLink<T>& l = elem->*link;
+		assert(!l.linked);
+		l.linked = true;
+		l.prev = nullptr;
+		l.next = first;
+		if (first) {
+			(first->*link).prev = elem;
+		} else {
+			last = elem;
+		}
+		first = elem;
+		++size;
+	}
+
+	// adds an element to the end of the list
+	// @param elem The element to add, which must not already be in a list through this link
+	void addLast(T* elem) {
+		IntrusiveLink<T>& l = elem->*link;
+		assert(!l.linked);
+		l.linked = true;
+		l.next = nullptr;
+		l.prev = last;
+		if (last) {
+			(last->*link).next = elem;
+		} else {
+			first = elem;
+		}
+		last = elem;
+		++size;
+	}
+
+	// unlinks an element from the list (the element itself is untouched)
+	// @param elem The element to remove, which must be in this list
+	void remove(T* elem) {
+		IntrusiveLink<T>& l = elem->*link;
+		assert(l.linked);
+		if (l.prev) {
+			(l.prev->*link).next = l.next;
+		} else {
+			first = l.next;
+		}
+		if (l.next) {
+			(l.next->*link).prev = l.prev;
+		} else {
+			last = l.prev;
+		}
+		l.next = nullptr;
+		l.prev = nullptr;
+		l.linked = false;
+		--size;
+	}
+
+	// unlinks every element from the list
+	void removeAll() {
+		T* next = nullptr;
+		for (T* elem = first; elem != nullptr; elem = next) {
+			IntrusiveLink<T>& l = elem->*link;
+			next = l.next;
+			l.next = nullptr;
+			l.prev = nullptr;
+			l.linked = false;
+		}
+		first = nullptr;
+		last = nullptr;
+		size = 0;
+	}
+
+	// Iterator
+	class Iterator {
+	public:
+		Iterator(T* _position) :
+			position(_position) {}
+
+		T* operator*() const {
+			assert(position != nullptr);
+			return position;
+		}
+		Iterator& operator++() {
+			assert(position != nullptr);
+			position = (position->*link).next;
+			return *this;
+		}
+		bool operator!=(const Iterator& it) const {
+			return position != it.position;
+		}
+	private:
+		T* position;
+	};
+
+	// begin()
+	Iterator begin() const {
+		return Iterator(first);
+	}
+
+	// end()
+	Iterator end() const {
+		return Iterator(nullptr);
+	}
+
+private:
+	T* first = nullptr;
+	T* last = nullptr;
+	size_t size = 0;
+};
@@ -5,6 +5,7 @@
 #include "ShaderProgram.hpp"
 #include "Renderer.hpp"
 #include "Line3D.hpp"
+#include "Counters.hpp"
 
 const GLfloat Line3D::vertices[6] = {
 	0.f, 0.f, 0.f,
@@ -41,6 +42,7 @@ Line3D::Line3D() {
 
 	// unbind vertex array
 	glBindVertexArray(0);
+	Counters::add(Counters::BUFFER_UPLOADS, 2);
 }
 
 Line3D::~Line3D() {
@@ -93,5 +95,6 @@ void Line3D::draw(Camera& camera, const glm::vec3& src, const glm::vec3& dest, c
 		glBindVertexArray(vao);
 		glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT, NULL);
 		glBindVertexArray(0);
+		Counters::add(Counters::DRAW_LINE3D);
 	}
 }
\ No newline at end of file
@@ -5,15 +5,21 @@
 #include "Main.hpp"
 #include "Node.hpp"
 
+#include <new>
+
 #include <luajit-2.0/lua.hpp>
 #include <LuaBridge/LuaBridge.h>
 
+// doubly linked list of nodes holding copies of their data
+// the memory of removed nodes is kept on a free list and reused by later inserts,
+// so a list that has reached its working size stops touching the heap
 template <typename T>
 class LinkedList {
 public:
 	LinkedList() {}
 	~LinkedList() {
 		removeAll();
+		trim();
 	}
 
 	// parameter functions
@@ -23,6 +29,7 @@ public:
 	const Node<T>* 		getFirst() const			{ return (const Node<T>*)(first); }
 	const Node<T>* 		getLast() const				{ return (const Node<T>*)(last); }
 	size_t				getSize() const				{ return size; }
+	size_t				getNumFree() const			{ return numFree; }
 
 	void 				setFirst(Node<T> *node)		{ first = node; }
 	void 				setLast(Node<T> *node)		{ last = node; }
@@ -84,7 +91,7 @@ public:
 	Node<T>* addNode(const size_t index, const T& data) {
 		Node<T>* node = nodeForIndex(index);
 		++size;
-		return new Node<T>(*this,node,data);
+		return newNode(node,data);
 	}
 
 	// adds a node to the beginning of the list
@@ -92,7 +99,7 @@ public:
 	// @return the newly created Node
 	Node<T>* addNodeFirst(const T& data) {
 		++size;
-		return new Node<T>(*this,first,data);
+		return newNode(first,data);
 	}
 
 	// adds a node to the end of the list
@@ -100,7 +107,7 @@ public:
 	// @return the newly created Node
 	Node<T>* addNodeLast(const T& data) {
 		++size;
-		return new Node<T>(*this,nullptr,data);
+		return newNode(nullptr,data);
 	}
 
 	// removes a node from the list
@@ -128,7 +135,7 @@ public:
 		}
 
 		--size;
-		delete node;
+		deleteNode(node);
 	}
 
 	// removes a node from the list
@@ -144,13 +151,23 @@ public:
 
 		for( node=first; node!=nullptr; node=nextnode ) {
 			nextnode = node->getNext();
-			delete node;
+			deleteNode(node);
 		}
 		first = nullptr;
 		last = nullptr;
 		size = 0;
 	}
 
+	// give the memory of removed nodes back to the heap
+	void trim() {
+		while( freeNodes != nullptr ) {
+			FreeNode* next = freeNodes->next;
+			::operator delete(freeNodes);
+			freeNodes = next;
+		}
+		numFree = 0;
+	}
+
 	// copy one list to another (also copies data)
 	void copy(const LinkedList<T>& src) {
 		for( const Node<T>* node = src.getFirst(); node != nullptr; node = node->getNext() ) {
@@ -298,6 +315,7 @@ public:
 			.addFunction("removeNode", removeNode)
 			.addFunction("removeNodeIndex", removeNodeIndex)
 			.addFunction("removeAll", &LinkedList<T>::removeAll)
+			.addFunction("trim", &LinkedList<T>::trim)
 			.addFunction("copy", &LinkedList<T>::copy)
 			.endClass()
 		;
@@ -306,9 +324,43 @@ public:
 	}
 
 private:
+	// a removed node, waiting to be reused
+	struct FreeNode {
+		FreeNode* next;
+	};
+
 	Node<T>* first	= nullptr;
 	Node<T>* last	= nullptr;
 	size_t size = 0;
+	FreeNode* freeNodes = nullptr;
+	size_t numFree = 0;
+
+	// construct a node, reusing a free one if there is any
+	// @param next the node to insert before, or nullptr to insert at the end
+	// @param data the data to be assigned to the node
+	// @return the new node, already linked into the list
+	Node<T>* newNode(Node<T>* next, const T& data) {
+		static_assert(sizeof(Node<T>) >= sizeof(FreeNode), "node too small to hold a free list link");
+		void* mem;
+		if( freeNodes != nullptr ) {
+			mem = freeNodes;
+			freeNodes = freeNodes->next;
+			--numFree;
+		} else {
+			mem = ::operator new(sizeof(Node<T>));
+		}
+		return new (mem) Node<T>(*this,next,data);
+	}
+
+	// destroy a node that is no longer linked and keep its memory for the next insert
+	// @param node the node to recycle
+	void deleteNode(Node<T>* node) {
+		node->~Node<T>();
+		FreeNode* freeNode = reinterpret_cast<FreeNode*>(node);
+		freeNode->next = freeNodes;
+		freeNodes = freeNode;
+		++numFree;
+	}
 
 	LinkedList<T>& merge(LinkedList<T>& left, LinkedList<T>& right) {
 		LinkedList<T> result;
@@ -3,6 +3,9 @@
 #include "Main.hpp"
 #include "Engine.hpp"
 #include "LinkedList.hpp"
+#include "Profiler.hpp"
+#include "Counters.hpp"
+#include "Allocations.hpp"
 
 Engine* mainEngine = nullptr;
 
@@ -11,8 +14,16 @@ const float SQRT2 = 1.41421356237309504f;
 const char* versionStr = "1.0.0.0";
 
 int main(int argc, char **argv) {
+	PROFILE_THREAD("main");
 	mainEngine = new Engine(argc,argv);
 
+	// "--selftest" runs the checks and quits, without opening a window
+	if( mainEngine->isSelfTest() ) {
+		const bool passed = mainEngine->runSelfTests();
+		delete mainEngine;
+		return passed ? 0 : 1;
+	}
+
 	// initialize mainEngine
 	mainEngine->init();
 	if( !mainEngine->isInitialized() ) {
@@ -25,7 +36,12 @@ int main(int argc, char **argv) {
 	while(mainEngine->isRunning()) {
 		mainEngine->preProcess();
 		mainEngine->process();
-		mainEngine->postProcess();
+		// the loop spins between timer ticks, so frames only end when one was drawn
+		if( mainEngine->postProcess() ) {
+			Profiler::endFrame();
+			Allocations::endFrame();
+			Counters::endFrame();
+		}
 	}
 	
 	delete mainEngine;
@@ -9,131 +9,166 @@
 
 #include <type_traits>
 
+// open addressing hash map
+// key/value pairs are kept packed in one list (in insertion order, until something is removed),
+// and a robin hood probed table of slots indexes into it.
+// inserting or removing pairs can move other pairs, so don't hold pointers to values across them.
 template <typename K, typename T>
 class Map {
 public:
-	static const size_t maxBucketSize = 1;
-
 	Map() {
-		data.resize(numBuckets);
 	}
+
+	// @param arena the arena to store the map in, or nullptr for the heap
+	explicit Map(Arena* arena) :
+		pairs(arena),
+		slots(arena) {}
 	~Map() {
 	}
 
 	// getters & setters
-	ArrayList<OrderedPair<K, T>>&				getHash(size_t index)			{ return data[index]; }
-	const ArrayList<OrderedPair<K, T>>&			getHash(size_t index) const		{ return data[index]; }
 	size_t										getNumBuckets() const			{ return numBuckets; }
-	size_t										getSize() const					{ return size; }
+	size_t										getSize() const					{ return pairs.getSize(); }
+	Arena*										getArena() const				{ return pairs.getArena(); }
 
 	// clears the map of all key/value pairs
 	void clear() {
-		for (auto& bucket : data) {
-			bucket.clear();
+		pairs.clear();
+		for (auto& slot : slots) {
+			slot = Slot();
 		}
-		size = 0;
 	}
 
-	// not only clears the map, but also resets its size
+	// not only clears the map, but also resets its size and releases its storage
 	void reset() {
-		data.clear();
-		size = 0;
-		numBuckets = 4;
-		data.resize(numBuckets);
+		pairs.clear();
+		pairs.shrink_to_fit();
+		slots.clear();
+		slots.shrink_to_fit();
+		numBuckets = 0;
+	}
+
+	// make room for a number of pairs, so inserting that many won't rehash
+	// @param count The number of pairs to make room for
+	void reserve(size_t count) {
+		pairs.reserve(count);
+		if (count * maxLoadDen > numBuckets * maxLoadNum) {
+			rehash(count);
+		}
 	}
 
 	// inserts a key/value pair into the Map
 	// @param key The key
 	// @param value The value associated with the key
 	void insert(const K& key, const T& value) {
-		T* oldValue = find(key);
-		if (oldValue) {
-			*oldValue = value;
-			return;
+		const Uint32 h = hash(key);
+		const size_t pos = findSlot(key, h);
+		if (pos != npos) {
+			pairs[slots[pos].index].b = value;
 		} else {
-			if (size + 1 >= numBuckets * maxBucketSize) {
-				rehash(numBuckets * 2);
-			}
+			addPair(h, OrderedPair<K, T>(key, value));
+		}
+	}
 
-			auto& list = data[hash(key) & (numBuckets - 1)];
-			list.push(OrderedPair<K, T>(key, value));
-			++size;
+	// constructs a value for the given key, unless the key already exists
+	// @param key The key
+	// @param args Arguments to construct the value with
+	// @return the value associated with the key, whether it is new or not
+	template <typename... Args>
+	T* emplace(const K& key, Args&&... args) {
+		const Uint32 h = hash(key);
+		const size_t pos = findSlot(key, h);
+		if (pos != npos) {
+			return &pairs[slots[pos].index].b;
+		} else {
+			addPair(h, OrderedPair<K, T>(key, T(std::forward<Args>(args)...)));
+			return &pairs.peek().b;
 		}
 	}
 
 	// resize and rebuild the hash map
-	// @param newBucketCount Updated number of buckets in the map
+	// @param newBucketCount Updated number of buckets in the map, rounded up to fit every pair
 	void rehash(size_t newBucketCount) {
-		ArrayList<OrderedPair<K, T>> list;
-		for (auto& it : *this) {
-			list.push(it);
+		size_t count = minBuckets;
+		while (count < newBucketCount || pairs.getSize() * maxLoadDen > count * maxLoadNum) {
+			count *= 2;
 		}
-		clear();
-		numBuckets = newBucketCount;
-		data.resize(numBuckets);
-		for (auto& it : list) {
-			insert(it.a, it.b);
+		numBuckets = count;
+		slots.clear();
+		slots.resize(numBuckets);
+		for (Uint32 c = 0; c < (Uint32)pairs.getSize(); ++c) {
+			Slot slot;
+			slot.hash = hash(pairs[c].a);
+			slot.index = c;
+			addSlot(slot);
 		}
 	}
 
 	// determine if the key with the given name exists
 	// @return true if key/value pair exists, false otherwise
 	bool exists(const K& key) const {
-		auto& list = data[hash(key) & (numBuckets - 1)];
-		for( auto& pair : list ) {
-			if( pair.a == key ) {
-				return true;
-			}
-		}
-		return false;
+		return findSlot(key, hash(key)) != npos;
+	}
+	bool exists(const char* key) const {
+		return findSlot(key, hash(key)) != npos;
 	}
 
 	// removes a key/value pair from the Map
+	// the last pair in the Map takes the place of the removed one
 	// @param key The key
 	// @return true if the key/value pair was removed, otherwise false
 	bool remove(const K& key) {
-		auto& list = data[hash(key) & (numBuckets - 1)];
-		for( size_t c = 0; c < list.getSize(); ++c ) {
-			auto& pair = list[c];
-			if( pair.a == key ) {
-				list.remove(c);
-				--size;
-				return true;
+		const size_t pos = findSlot(key, hash(key));
+		if (pos == npos) {
+			return false;
+		}
+		const Uint32 index = slots[pos].index;
+		removeSlot(pos);
+
+		// point the last pair's slot at the hole it will fill
+		const Uint32 last = (Uint32)pairs.getSize() - 1;
+		if (index != last) {
+			const size_t mask = numBuckets - 1;
+			size_t lastPos = hash(pairs[last].a) & mask;
+			while (slots[lastPos].index != last) {
+				lastPos = (lastPos + 1) & mask;
 			}
+			slots[lastPos].index = index;
 		}
-		return false;
+		pairs.remove(index);
+		return true;
 	}
 
 	// find the key/value pair with the given name
 	// @param key The name of the pair to find
 	// @return the value associated with the key, or nullptr if it could not be found
 	T* find(const K& key) {
-		auto& list = data[hash(key) & (numBuckets - 1)];
-		for( auto& pair : list ) {
-			if( pair.a == key ) {
-				return &pair.b;
-			}
-		}
-		return nullptr;
+		const size_t pos = findSlot(key, hash(key));
+		return pos != npos ? &pairs[slots[pos].index].b : nullptr;
 	}
 	const T* find(const K& key) const {
-		auto& list = data[hash(key) & (numBuckets - 1)];
-		for( auto& pair : list ) {
-			if( pair.a == key ) {
-				return &pair.b;
-			}
-		}
-		return nullptr;
+		const size_t pos = findSlot(key, hash(key));
+		return pos != npos ? &pairs[slots[pos].index].b : nullptr;
+	}
+
+	// find the key/value pair with the given name, without making a key out of it first
+	// @param key The name of the pair to find
+	// @return the value associated with the key, or nullptr if it could not be found
+	T* find(const char* key) {
+		const size_t pos = findSlot(key, hash(key));
+		return pos != npos ? &pairs[slots[pos].index].b : nullptr;
+	}
+	const T* find(const char* key) const {
+		const size_t pos = findSlot(key, hash(key));
+		return pos != npos ? &pairs[slots[pos].index].b : nullptr;
 	}
 
 	// replace the contents of this map with those of another
 	// @param src The map to copy
 	void copy(const Map<K, T>& src) {
-		clear();
-		rehash(src.getNumBuckets());
-		for (auto& it : src) {
-			insert(it.a, it.b);
-		}
+		pairs.copy(src.pairs);
+		slots.copy(src.slots);
+		numBuckets = src.numBuckets;
 	}
 
 	// save/load this object to a file
@@ -143,6 +178,7 @@ public:
 			Uint32 keyCount = 0;
 			file->propertyName("data");
 			file->beginArray(keyCount);
+			reserve(pairs.getSize() + keyCount);
 			for( Uint32 c = 0; c < keyCount; ++c ) {
 				K key;
 				T value;
@@ -156,14 +192,11 @@ public:
 			}
 			file->endArray();
 		} else {
-			Uint32 keyCount = 0;
-			for (Uint32 c = 0; c < numBuckets; ++c) {
-				keyCount += static_cast<Uint32>(data[c].getSize());
-			}
+			Uint32 keyCount = static_cast<Uint32>(pairs.getSize());
 
 			file->propertyName("data");
 			file->beginArray(keyCount);
-			for( auto& pair : *this ) {
+			for( auto& pair : pairs ) {
 				file->beginObject();
 				file->property("key", pair.a);
 				file->property("value", pair.b);
@@ -180,114 +213,153 @@ public:
 		return find(key);
 	}
 	const T* operator[](const K& key) const {
-		return (const T*)(find(key));
+		return find(key);
+	}
+	T* operator[](const char* key) {
+		return find(key);
+	}
+	const T* operator[](const char* key) const {
+		return find(key);
 	}
 
 	// Iterator
-	class Iterator {
-	public:
-		Iterator(Map<K, T>& _map, size_t _position, size_t _bucket) :
-			map(_map),
-			position(_position),
-			bucket(_bucket) {}
-
-		OrderedPair<K, T>& operator*() {
-			assert(bucket >= 0 && bucket < map.getNumBuckets());
-			assert(position >= 0 && position < map.getHash(bucket).getSize());
-			return map.getHash(bucket)[position];
-		}
-		Iterator& operator++() {
-			++position;
-			while( bucket < map.getNumBuckets() && position >= map.getHash(bucket).getSize() ) {
-				++bucket;
-				position = 0;
-			}
-			return *this;
-		}
-		bool operator!=(const Iterator& it) const {
-			return position != it.position || bucket != it.bucket;
-		}
-	private:
-		Map<K, T>& map;
-		size_t position;
-		size_t bucket;
-	};
-
-	// ConstIterator
-	class ConstIterator {
-	public:
-		ConstIterator(const Map<K, T>& _map, size_t _position, size_t _bucket) :
-			map(_map),
-			position(_position),
-			bucket(_bucket) {}
-
-		const OrderedPair<K, T>& operator*() const {
-			assert(bucket >= 0 && bucket < map.getNumBuckets());
-			assert(position >= 0 && position < map.getHash(bucket).getSize());
-			return map.getHash(bucket)[position];
-		}
-		ConstIterator& operator++() {
-			++position;
-			while( bucket < map.getNumBuckets() && position >= map.getHash(bucket).getSize() ) {
-				++bucket;
-				position = 0;
-			}
-			return *this;
-		}
-		bool operator!=(const ConstIterator& it) const {
-			return position != it.position || bucket != it.bucket;
-		}
-	private:
-		const Map<K, T>& map;
-		size_t position;
-		size_t bucket;
-	};
+	typedef typename ArrayList<OrderedPair<K, T>>::Iterator Iterator;
+	typedef typename ArrayList<OrderedPair<K, T>>::ConstIterator ConstIterator;
 
 	// begin()
 	Iterator begin() {
-		size_t c = 0;
-		for (; c < numBuckets; ++c) {
-			if (data[c].getSize()) {
-				return Iterator(*this, 0, c);
-			}
-		}
-		return Iterator(*this, 0, c);
+		return pairs.begin();
 	}
 	const ConstIterator begin() const {
-		size_t c = 0;
-		for (; c < numBuckets; ++c) {
-			if (data[c].getSize()) {
-				return ConstIterator(*this, 0, c);
-			}
-		}
-		return ConstIterator(*this, 0, c);
+		return pairs.begin();
 	}
 
 	// end()
 	Iterator end() {
-		return Iterator(*this, 0, numBuckets);
+		return pairs.end();
 	}
 	const ConstIterator end() const {
-		return ConstIterator(*this, 0, numBuckets);
+		return pairs.end();
 	}
 
 private:
-	ArrayList<ArrayList<OrderedPair<K, T>>> data;
-	size_t numBuckets = 4;
-	size_t size = 0;
+	static const size_t npos = SIZE_MAX;
+	static const size_t minBuckets = 8;
+
+	// the table is grown before it is more than 7/8 full
+	static const size_t maxLoadNum = 7;
+	static const size_t maxLoadDen = 8;
+
+	// a slot in the table, pointing at a pair
+	struct Slot {
+		static const Uint32 empty = UINT32_MAX;
+		Uint32 hash = 0;
+		Uint32 index = empty;
+	};
+
+	ArrayList<OrderedPair<K, T>> pairs;
+	ArrayList<Slot> slots;
+	size_t numBuckets = 0;
+
+	// @return how far the slot at the given position is from the one its hash prefers
+	size_t probeDistance(const Slot& slot, size_t pos) const {
+		return (pos - slot.hash) & (numBuckets - 1);
+	}
+
+	// find the slot holding a key
+	// @param key The key to find
+	// @param h The hash of the key
+	// @return the position of the slot, or npos if the key is not in the map
+	template <typename Key>
+	size_t findSlot(const Key& key, Uint32 h) const {
+		if (numBuckets == 0) {
+			return npos;
+		}
+		const size_t mask = numBuckets - 1;
+		for (size_t pos = h & mask, dist = 0; ; pos = (pos + 1) & mask, ++dist) {
+			const Slot& slot = slots[pos];
+
+			// robin hood order means the key would have been placed before any slot nearer its home
+			if (slot.index == Slot::empty || probeDistance(slot, pos) < dist) {
+				return npos;
+			}
+			if (slot.hash == h && pairs[slot.index].a == key) {
+				return pos;
+			}
+		}
+	}
 
-	template <typename K>
-	typename std::enable_if<std::is_class<K>::value, unsigned long>::type
-	hash(const K& key) const {
-		return key.hash();
+	// add a pair that isn't in the map yet
+	// @param h The hash of the pair's key
+	// @param pair The pair to add
+	void addPair(Uint32 h, OrderedPair<K, T>&& pair) {
+		if ((pairs.getSize() + 1) * maxLoadDen > numBuckets * maxLoadNum) {
+			rehash(numBuckets * 2);
+		}
+		Slot slot;
+		slot.hash = h;
+		slot.index = (Uint32)pairs.getSize();
+		pairs.push(std::move(pair));
+		addSlot(slot);
 	}
-	unsigned long hash(Sint32 key) const {
-		return static_cast<unsigned long>(key);
+
+	// place a slot in the table, displacing slots that are nearer their homes
+	// @param slot The slot to place
+	void addSlot(Slot slot) {
+		const size_t mask = numBuckets - 1;
+		for (size_t pos = slot.hash & mask, dist = 0; ; pos = (pos + 1) & mask, ++dist) {
+			Slot& other = slots[pos];
+			if (other.index == Slot::empty) {
+				other = slot;
+				return;
+			}
+			const size_t otherDist = probeDistance(other, pos);
+			if (otherDist < dist) {
+				std::swap(other, slot);
+				dist = otherDist;
+			}
+		}
 	}
-	unsigned long hash(Uint32 key) const {
-		return static_cast<unsigned long>(key);
+
+	// empty a slot, shifting back the slots probed past it
+	// @param pos The position of the slot to empty
+	void removeSlot(size_t pos) {
+		const size_t mask = numBuckets - 1;
+		for (size_t next = (pos + 1) & mask; ; pos = next, next = (next + 1) & mask) {
+			const Slot& slot = slots[next];
+			if (slot.index == Slot::empty || probeDistance(slot, next) == 0) {
+				break;
+			}
+			slots[pos] = slot;
+		}
+		slots[pos] = Slot();
+	}
+
+	template <typename U>
+	typename std::enable_if<std::is_class<U>::value, Uint32>::type
+	hash(const U& key) const {
+		return static_cast<Uint32>(key.hash());
+	}
+	Uint32 hash(Sint32 key) const {
+		return static_cast<Uint32>(key);
+	}
+	Uint32 hash(Uint32 key) const {
+		return key;
 	}
-	unsigned long hash(bool key) const {
+	Uint32 hash(bool key) const {
 		return key ? 1 : 0;
 	}
+
+	// matches String::hash()
+	Uint32 hash(const char* key) const {
+		if (key == nullptr) {
+			return 0;
+		}
+		unsigned long value = 5381;
+		int c;
+		while((c = *key++)!=0) {
+			value = ((value << 5) + value) + c; // hash * 33 + c
+		}
+		return static_cast<Uint32>(value);
+	}
 };
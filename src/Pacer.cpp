@@ -0,0 +1,100 @@
+// Pacer.cpp
+
+#include "Main.hpp"
+#include "Pacer.hpp"
+
+#include <thread>
+
+const double Pacer::maxSpinFraction = 0.5;
+const double Pacer::defaultSpinMargin = 0.002;
+
+Pacer::Pacer() :
+	Pacer(60.0)
+{
+}
+
+Pacer::Pacer(double _ticksPerSecond) :
+	interval(1.0 / _ticksPerSecond),
+	spinMargin(defaultSpinMargin)
+{
+	restart();
+}
+
+void Pacer::setTicksPerSecond(double _ticksPerSecond) {
+	assert(_ticksPerSecond > 0.0);
+	interval = Seconds(1.0 / _ticksPerSecond);
+	restart();
+}
+
+void Pacer::restart() {
+	deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(interval);
+}
+
+Uint32 Pacer::wait() {
+	const Clock::duration step = std::chrono::duration_cast<Clock::duration>(interval);
+
+	// sleep through most of the wait, measuring how far past the wake-up time the os lets us run
+	const Clock::time_point wake = deadline - std::chrono::duration_cast<Clock::duration>(spinMargin);
+	if (Clock::now() < wake) {
+		std::this_thread::sleep_until(wake);
+		const Seconds overslept = Clock::now() - wake;
+
+		// jump straight up to a late wake-up, then ease back down as they get better
+		const Seconds maxMargin = interval * maxSpinFraction;
+		if (overslept > spinMargin) {
+			spinMargin = std::min(overslept * 1.25, maxMargin);
+		} else {
+			spinMargin -= (spinMargin - overslept) / 64.0;
+		}
+	}
+
+	// spin out the rest
+	Clock::time_point now = Clock::now();
+	while (now < deadline) {
+		std::this_thread::yield();
+		now = Clock::now();
+	}
+	const double lateness = Seconds(now - deadline).count() * 1000.0;
+
+	// if we've fallen a whole tick behind, skip the deadlines we missed rather than rushing to catch up
+	Uint32 skipped = 0;
+	deadline += step;
+	if (deadline <= now) {
+		const Clock::duration behind = now - deadline;
+		skipped = (Uint32)(behind / step) + 1;
+		deadline += step * skipped;
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	++ticks;
+	missed += skipped;
+	latenessSum += lateness;
+	latenessSumSq += lateness * lateness;
+	latenessMax = std::max(latenessMax, lateness);
+	latestSpinMargin = spinMargin.count() * 1000.0;
+	return skipped;
+}
+
+Pacer::Stats Pacer::getStats() const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	Stats stats;
+	stats.ticks = ticks;
+	stats.missed = missed;
+	stats.spinMargin = latestSpinMargin;
+	if (ticks) {
+		stats.meanLateness = latenessSum / ticks;
+		stats.maxLateness = latenessMax;
+		const double variance = latenessSumSq / ticks - stats.meanLateness * stats.meanLateness;
+		stats.jitter = sqrt(std::max(variance, 0.0));
+	}
+	return stats;
+}
+
+void Pacer::resetStats() {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	ticks = 0;
+	missed = 0;
+	latenessSum = 0.0;
+	latenessSumSq = 0.0;
+	latenessMax = 0.0;
+}
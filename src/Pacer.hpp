@@ -0,0 +1,70 @@
+// Pacer.hpp
+// Wakes a thread at a steady rate without burning a core
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <chrono>
+#include <mutex>
+
+// ticks are scheduled against absolute deadlines, so they don't drift however long each one takes.
+// the pacer sleeps until shortly before each deadline and spins only for the last moment,
+// where the margin it spins for follows how late the os actually wakes it up
+class Pacer {
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef std::chrono::duration<double> Seconds;
+
+	Pacer();
+	Pacer(double _ticksPerSecond);
+
+	// timing statistics, in milliseconds
+	struct Stats {
+		Uint32 ticks = 0;			// ticks waited for
+		Uint32 missed = 0;			// deadlines skipped because a tick ran over
+		double meanLateness = 0.0;	// how long after its deadline each tick woke up
+		double maxLateness = 0.0;
+		double jitter = 0.0;		// standard deviation of the lateness
+		double spinMargin = 0.0;	// how early the pacer is waking up to spin
+	};
+
+	// the longest the pacer will spin for, as a fraction of a tick
+	static const double maxSpinFraction;
+
+	// the margin the pacer starts with, before it has seen how the os sleeps
+	static const double defaultSpinMargin;
+
+	// getters & setters
+	double						getTicksPerSecond() const			{ return 1.0 / interval.count(); }
+
+	// change the rate, starting from now
+	// @param _ticksPerSecond the number of ticks per second
+	void setTicksPerSecond(double _ticksPerSecond);
+
+	// schedule the next tick one interval from now
+	void restart();
+
+	// block until the next tick is due
+	// @return the number of deadlines skipped since the last tick, because they had already passed
+	Uint32 wait();
+
+	// @return the statistics since they were last reset (safe to call from any thread)
+	Stats getStats() const;
+
+	// clear the statistics (safe to call from any thread)
+	void resetStats();
+
+private:
+	Seconds interval;
+	Clock::time_point deadline;
+	Seconds spinMargin;
+
+	mutable std::mutex statsMutex;
+	Uint32 ticks = 0;
+	Uint32 missed = 0;
+	double latenessSum = 0.0;
+	double latenessSumSq = 0.0;
+	double latenessMax = 0.0;
+	double latestSpinMargin = 0.0;
+};
@@ -0,0 +1,306 @@
+// Profiler.cpp
+
+#include "Main.hpp"
+#include "Engine.hpp"
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <mutex>
+
+const double Profiler::summaryPeriod = 1.0;
+const Uint32 Profiler::defaultCaptureFrames = 300;
+const size_t Profiler::maxCaptureEvents = 1000000;
+
+std::atomic_bool Profiler::collecting(false);
+bool Profiler::overlayVisible = false;
+Uint32 Profiler::captureFrames = 0;
+Profiler::Summary Profiler::summary;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// everything below is shared between threads, and guarded by this
+static std::mutex profilerLock;
+static ArrayList<Profiler::Event> pendingEvents;	// handed over since the last frame
+static ArrayList<const char*> threadNames;			// by thread index
+static ArrayList<Uint32> freeThreads;				// indices of threads that have exited
+
+// the calling thread's scopes, until its outermost one ends
+// threads come and go with every batch of ai work, so their indices are recycled when they exit
+struct ProfilerThread {
+	ProfilerThread() {
+		std::lock_guard<std::mutex> lock(profilerLock);
+		if( freeThreads.getSize() ) {
+			index = freeThreads.pop();
+			threadNames[index] = nullptr;
+		} else {
+			index = (Uint32)threadNames.getSize();
+			threadNames.push(nullptr);
+		}
+	}
+	~ProfilerThread() {
+		std::lock_guard<std::mutex> lock(profilerLock);
+		freeThreads.push(index);
+	}
+
+	Uint32 index = 0;
+	Uint32 depth = 0;
+	ArrayList<Profiler::Event> events;
+};
+static thread_local ProfilerThread profilerThread;
+
+// kept apart from the rest, so naming a thread doesn't register it
+static thread_local const char* profilerThreadName = nullptr;
+
+// only touched by the thread that ends frames
+static ArrayList<Profiler::Event> frameEvents;
+static ArrayList<const char*> frameThreadNames;		// by thread index, as of the end of the frame
+static ArrayList<Profiler::Event> captureEvents;
+static ArrayList<const char*> captureThreadNames;
+static String captureFilename;
+static Uint64 lastFrameEnd = 0;
+static Uint64 periodStart = 0;
+static Uint32 periodFrames = 0;
+static ArrayList<Profiler::Row> periodRows;
+static ArrayList<Profiler::ThreadRow> periodThreads;
+static ArrayList<double> rowFrameMs;				// time spent in each period row this frame
+static ArrayList<Uint32> threadSeen;				// frame each thread index last did anything in
+
+// @return the name of a thread, only to be called while holding profilerLock
+static const char* threadName(Uint32 index) {
+	const char* name = index < threadNames.getSize() ? threadNames[index] : nullptr;
+	return name ? name : "worker";
+}
+
+Uint64 Profiler::now() {
+	return (Uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+Uint64 Profiler::begin() {
+	++profilerThread.depth;
+	return now();
+}
+
+void Profiler::end(const char* name, Uint64 start) {
+	ProfilerThread& thread = profilerThread;
+	assert(thread.depth > 0);
+	--thread.depth;
+
+	Event& event = thread.events.emplace();
+	event.name = name;
+	event.start = start;
+	event.end = now();
+	event.thread = thread.index;
+	event.depth = thread.depth;
+
+	if( thread.depth == 0 ) {
+		submit();
+	}
+}
+
+void Profiler::submit() {
+	ProfilerThread& thread = profilerThread;
+	std::lock_guard<std::mutex> lock(profilerLock);
+	threadNames[thread.index] = profilerThreadName;
+	for( auto& event : thread.events ) {
+		pendingEvents.push(event);
+	}
+	thread.events.clear();
+}
+
+void Profiler::setThreadName(const char* name) {
+	profilerThreadName = name;
+}
+
+void Profiler::setOverlayVisible(bool visible) {
+	overlayVisible = visible;
+	collecting = overlayVisible || captureFrames > 0;
+	if( overlayVisible ) {
+		// start the first period afresh, rather than from whenever the overlay was last shown
+		periodStart = now();
+		periodFrames = 0;
+		periodRows.clear();
+		periodThreads.clear();
+	}
+}
+
+void Profiler::startCapture(Uint32 frames, const char* filename) {
+	if( captureFrames > 0 ) {
+		mainEngine->fmsg(Engine::MSG_WARN, "already capturing a trace to '%s'", captureFilename.get());
+		return;
+	}
+	if( frames == 0 ) {
+		return;
+	}
+	captureFilename = filename;
+	captureEvents.clear();
+	captureThreadNames.clear();
+	captureFrames = frames;
+	collecting = true;
+	mainEngine->fmsg(Engine::MSG_INFO, "capturing %u frames to '%s'...", frames, filename);
+}
+
+void Profiler::endFrame() {
+	const Uint64 frameStart = lastFrameEnd;
+	const Uint64 frameEnd = now();
+	lastFrameEnd = frameEnd;
+	if( !collecting ) {
+		return;
+	}
+
+	// take everything handed over since the last frame, along with the names of the threads it ran on
+	const Uint32 frameThread = profilerThread.index;
+	frameEvents.clear();
+	{
+		std::lock_guard<std::mutex> lock(profilerLock);
+		frameEvents.swap(pendingEvents);
+		frameThreadNames.resize(threadNames.getSize());
+		for( Uint32 c = 0; c < threadNames.getSize(); ++c ) {
+			frameThreadNames[c] = threadName(c);
+		}
+	}
+	frameThreadNames[frameThread] = profilerThreadName ? profilerThreadName : "worker";
+
+	if( captureFrames > 0 ) {
+		if( captureEvents.getSize() + frameEvents.getSize() + 1 > maxCaptureEvents ) {
+			mainEngine->fmsg(Engine::MSG_WARN, "trace is full, stopping %u frames early", captureFrames);
+			captureFrames = 0;
+		} else {
+			Event& frame = captureEvents.emplace();
+			frame.name = "frame";
+			frame.start = frameStart;
+			frame.end = frameEnd;
+			frame.thread = frameThread;
+			for( auto& event : frameEvents ) {
+				captureEvents.push(event);
+				if( captureThreadNames.getSize() <= event.thread ) {
+					captureThreadNames.resize(event.thread + 1);
+				}
+				captureThreadNames[event.thread] = frameThreadNames[event.thread];
+			}
+			if( captureThreadNames.getSize() <= frameThread ) {
+				captureThreadNames.resize(frameThread + 1);
+			}
+			captureThreadNames[frameThread] = frameThreadNames[frameThread];
+			--captureFrames;
+		}
+		if( captureFrames == 0 ) {
+			writeCapture();
+		}
+	}
+
+	if( overlayVisible ) {
+		++periodFrames;
+		rowFrameMs.resize(periodRows.getSize());
+		for( auto& ms : rowFrameMs ) {
+			ms = 0.0;
+		}
+		if( threadSeen.getSize() < frameThreadNames.getSize() ) {
+			threadSeen.resize(frameThreadNames.getSize());
+		}
+
+		// outer scopes start first, so they get their rows ahead of the scopes nested in them
+		std::sort(frameEvents.getArray(), frameEvents.getArray() + frameEvents.getSize(),
+			[](const Event& a, const Event& b) { return a.start < b.start; });
+		for( auto& event : frameEvents ) {
+			const char* thread = frameThreadNames[event.thread];
+			const double ms = (event.end - event.start) / 1000000.0;
+
+			// rows are few, and names are literals, so a linear search by pointer does
+			size_t index = 0;
+			for( ; index < periodRows.getSize(); ++index ) {
+				const Row& row = periodRows[index];
+				if( row.name == event.name && row.thread == thread && row.depth == event.depth ) {
+					break;
+				}
+			}
+			if( index == periodRows.getSize() ) {
+				Row& row = periodRows.emplace();
+				row.name = event.name;
+				row.thread = thread;
+				row.depth = event.depth;
+				rowFrameMs.push(0.0);
+			}
+			periodRows[index].calls += 1.0;
+			rowFrameMs[index] += ms;
+
+			if( event.depth == 0 ) {
+				size_t t = 0;
+				for( ; t < periodThreads.getSize(); ++t ) {
+					if( periodThreads[t].name == thread ) {
+						break;
+					}
+				}
+				if( t == periodThreads.getSize() ) {
+					periodThreads.emplace().name = thread;
+				}
+				periodThreads[t].busyMs += ms;
+				if( threadSeen[event.thread] != periodFrames ) {
+					threadSeen[event.thread] = periodFrames;
+					periodThreads[t].count += 1.0;
+				}
+			}
+		}
+		for( size_t c = 0; c < periodRows.getSize(); ++c ) {
+			periodRows[c].ms += rowFrameMs[c];
+			periodRows[c].maxMs = std::max(periodRows[c].maxMs, rowFrameMs[c]);
+		}
+
+		// turn the totals into averages, and start a new period
+		const double elapsed = (frameEnd - periodStart) / 1000000000.0;
+		if( elapsed >= summaryPeriod && periodFrames > 0 ) {
+			const double frames = (double)periodFrames;
+			summary.rows.clear();
+			for( auto& row : periodRows ) {
+				Row& average = summary.rows.emplace(row);
+				average.ms /= frames;
+				average.calls /= frames;
+			}
+			summary.threads.clear();
+			for( auto& thread : periodThreads ) {
+				ThreadRow& average = summary.threads.emplace(thread);
+				average.busyMs /= frames;
+				average.count /= frames;
+			}
+			summary.frames = periodFrames;
+			summary.frameMs = elapsed * 1000.0 / frames;
+			++summary.serial;
+
+			periodStart = frameEnd;
+			periodFrames = 0;
+			periodRows.clear();
+			periodThreads.clear();
+			threadSeen.clear();
+		}
+	}
+
+	collecting = overlayVisible || captureFrames > 0;
+}
+
+void Profiler::writeCapture() {
+	FILE* fp = nullptr;
+	if( fopen_s(&fp, captureFilename.get(), "wb") || !fp ) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "failed to open '%s' to write a trace", captureFilename.get());
+		captureEvents.clear();
+		return;
+	}
+
+	// chrome trace-event format, with times in microseconds
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"%s\"}}", mainEngine->getGameTitle());
+	for( Uint32 c = 0; c < captureThreadNames.getSize(); ++c ) {
+		if( captureThreadNames[c] ) {
+			fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+				c, captureThreadNames[c], c);
+		}
+	}
+	for( auto& event : captureEvents ) {
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+			event.name, event.thread, event.start / 1000.0, (event.end - event.start) / 1000.0, event.depth);
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	mainEngine->fmsg(Engine::MSG_INFO, "wrote %u trace events to '%s'", (Uint32)captureEvents.getSize(), captureFilename.get());
+	captureEvents.clear();
+	captureEvents.shrink_to_fit();
+}
@@ -0,0 +1,143 @@
+// Profiler.hpp
+// Scoped timing markers, gathered per frame and per thread, with an overlay and chrome trace export
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+
+#include <atomic>
+
+// PROFILE_SCOPE("name") times the rest of the enclosing block, PROFILE_THREAD("name") names the calling thread.
+// names are kept by pointer, so they must be string literals.
+// define NO_PROFILER to compile every marker out of the build
+#ifndef NO_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+// markers only check a flag until the overlay is shown or a capture is running.
+// each thread times its scopes into a buffer of its own and hands them over when its outermost scope ends,
+// then everything handed over since the last frame is summarized and captured when the frame ends
+class Profiler {
+public:
+	// a timed scope
+	struct Event {
+		const char* name = nullptr;
+		Uint64 start = 0;		// nanoseconds since the profiler started
+		Uint64 end = 0;
+		Uint32 thread = 0;		// index of the thread it ran on
+		Uint32 depth = 0;		// number of scopes it was nested in
+	};
+
+	// one scope on one kind of thread, averaged per frame
+	struct Row {
+		const char* name = nullptr;
+		const char* thread = nullptr;
+		Uint32 depth = 0;
+		double ms = 0.0;		// total time, in milliseconds
+		double maxMs = 0.0;		// most time in any one frame
+		double calls = 0.0;
+	};
+
+	// one kind of thread, averaged per frame
+	struct ThreadRow {
+		const char* name = nullptr;
+		double busyMs = 0.0;	// time spent in outermost scopes, added up over all threads of this kind
+		double count = 0.0;		// threads that did anything
+	};
+
+	// averages over the frames of the last summary period
+	struct Summary {
+		Uint32 serial = 0;		// bumped whenever the summary changes
+		Uint32 frames = 0;
+		double frameMs = 0.0;
+		ArrayList<Row> rows;
+		ArrayList<ThreadRow> threads;
+	};
+
+	// how often the summary is refreshed, in seconds
+	static const double summaryPeriod;
+
+	// frames captured by a trace when no number is given
+	static const Uint32 defaultCaptureFrames;
+
+	// most events a trace will hold, it stops early once it has this many
+	static const size_t maxCaptureEvents;
+
+	// times a scope, from construction until destruction
+	class Scope {
+	public:
+		Scope(const char* _name) {
+			if( collecting.load(std::memory_order_relaxed) ) {
+				name = _name;
+				start = begin();
+			}
+		}
+		~Scope() {
+			if( name ) {
+				end(name, start);
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name = nullptr;
+		Uint64 start = 0;
+	};
+
+	// getters & setters
+	static bool							isCollecting()								{ return collecting.load(std::memory_order_relaxed); }
+	static bool							isOverlayVisible()							{ return overlayVisible; }
+	static bool							isCapturing()								{ return captureFrames > 0; }
+
+	// the latest summary, only to be used on the thread that ends frames
+	static const Summary&				getSummary()								{ return summary; }
+
+	// show or hide the overlay, timing is only summarized while it is shown
+	static void setOverlayVisible(bool visible);
+
+	// name the calling thread, for the overlay and traces. unnamed threads are called "worker"
+	// @param name the name of the thread (a string literal)
+	static void setThreadName(const char* name);
+
+	// record the next few frames and write them out as a chrome trace (chrome://tracing, or ui.perfetto.dev)
+	// @param frames the number of frames to record
+	// @param filename the file to write the trace to
+	static void startCapture(Uint32 frames, const char* filename);
+
+	// end the current frame: summarize and capture everything timed since the last one
+	// must always be called from the same thread, which is recorded as the one frames run on
+	static void endFrame();
+
+	// @return nanoseconds since the profiler started
+	static Uint64 now();
+
+private:
+	static std::atomic_bool collecting;
+	static bool overlayVisible;
+	static Uint32 captureFrames;
+	static Summary summary;
+
+	// start timing a scope on the calling thread
+	// @return the time it started
+	static Uint64 begin();
+
+	// finish timing a scope on the calling thread
+	// @param name the name of the scope
+	// @param start the time it started
+	static void end(const char* name, Uint64 start);
+
+	// hand the calling thread's events over to the next frame
+	static void submit();
+
+	// write out the events captured so far
+	static void writeCapture();
+};
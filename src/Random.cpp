@@ -4,25 +4,88 @@
 #include "Engine.hpp"
 #include "Random.hpp"
 
-Random::Random() {
+const char* Random::algorithmNames[(int)Random::Algorithm::ALGORITHM_MAX] = {
+	"xoshiro",
+	"philox",
+	"rc4"
+};
+
+Random::Algorithm Random::defaultAlgorithm = Random::Algorithm::XOSHIRO;
+
+// mixes a 64-bit value and advances it (splitmix64), for expanding seeds
+static Uint64 splitMix(Uint64& x) {
+	Uint64 z = (x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static inline Uint64 rotl(const Uint64 x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+Random::Random() :
+	algorithm(defaultAlgorithm)
+{
 	seedTime();
 }
 
+Random::Random(Algorithm _algorithm) :
+	algorithm(_algorithm)
+{
+	seedTime();
+}
+
+bool Random::algorithmForName(const char* name, Algorithm& result) {
+	for (int c = 0; c < (int)Algorithm::ALGORITHM_MAX; ++c) {
+		if (strcmp(name, algorithmNames[c]) == 0) {
+			result = (Algorithm)c;
+			return true;
+		}
+	}
+	return false;
+}
+
 void Random::seedBytes(const Uint8* seed, size_t size) {
 	if( !seed || !size )
 		return;
+	splitDepth = 0;
+
+	if( algorithm == Algorithm::RC4 ) {
+		Uint8* s = state.rc4.s;
+		Sint32 i, j;
 
-	Sint32 i, j;
+		for( i=0; i<256; ++i )
+			s[i] = i;
 
-	for( i=0; i<256; ++i )
-		s[i] = i;
+		for( i=j=0; i<256; ++i ) {
+			j = (j + s[i] + getByte(seed, size, i)) & 255;
+			swapByte(s + i, s + j);
+		}
 
-	for( i=j=0; i<256; ++i ) { 
-		j = (j + s[i] + getByte(seed, size, i)) & 255;
-		swapByte(s + i, s + j);
+		state.rc4.i = state.rc4.j = 0;
+		return;
 	}
 
-	s_i = s_j = 0;
+	// fold the seed into 64 bits (FNV-1a), then expand it
+	Uint64 x = 0xcbf29ce484222325ull;
+	for( size_t c = 0; c < size; ++c ) {
+		x = (x ^ seed[c]) * 0x100000001b3ull;
+	}
+	if( algorithm == Algorithm::PHILOX ) {
+		const Uint64 key = splitMix(x);
+		state.philox.key[0] = (Uint32)key;
+		state.philox.key[1] = (Uint32)(key >> 32);
+		for( int c = 0; c < 4; ++c ) {
+			state.philox.counter[c] = 0;
+		}
+		state.philox.index = 4;
+		state.philox.splits = 0;
+	} else {
+		for( int c = 0; c < 4; ++c ) {
+			state.xoshiro.s[c] = splitMix(x);
+		}
+	}
 }
 
 void Random::seedTime()  {
@@ -39,7 +102,93 @@ void Random::seedValue(Uint32 seed) {
 	seedBytes( (const Uint8*)&seed, sizeof(Uint32) );
 }
 
-Uint8 Random::getUint8() {
+void Random::jumpXoshiro(const Uint64 (&polynomial)[4]) {
+	Uint64 s[4] = { 0, 0, 0, 0 };
+	for( int i = 0; i < 4; ++i ) {
+		for( int b = 0; b < 64; ++b ) {
+			if( polynomial[i] & (1ull << b) ) {
+				for( int c = 0; c < 4; ++c ) {
+					s[c] ^= state.xoshiro.s[c];
+				}
+			}
+			nextXoshiro();
+		}
+	}
+	for( int c = 0; c < 4; ++c ) {
+		state.xoshiro.s[c] = s[c];
+	}
+}
+
+void Random::jump() {
+	switch( algorithm ) {
+		case Algorithm::XOSHIRO: {
+			// 2^128 numbers
+			static const Uint64 polynomial[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+			jumpXoshiro(polynomial);
+			break;
+		}
+		case Algorithm::PHILOX: {
+			state.philox.counter[0] = 0;
+			state.philox.counter[1] = 0;
+			if( ++state.philox.counter[2] == 0 ) {
+				++state.philox.counter[3];
+			}
+			state.philox.index = 4;
+			break;
+		}
+		default: {
+			Uint8 seed[32];
+			getBytes(seed, sizeof(seed));
+			seedBytes(seed, sizeof(seed));
+			break;
+		}
+	}
+}
+
+Random Random::split() {
+	Random result(*this);
+	switch( algorithm ) {
+		case Algorithm::XOSHIRO: {
+			// the child keeps everything up to where this one leaps to. a first split leaps 2^192 numbers,
+			// which leaves the child room to split 2^64 times with ordinary 2^128 jumps
+			assert(splitDepth < 2);
+			if( splitDepth == 0 ) {
+				static const Uint64 polynomial[4] = { 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull };
+				jumpXoshiro(polynomial);
+			} else {
+				jump();
+			}
+			result.splitDepth = splitDepth + 1;
+			break;
+		}
+		case Algorithm::PHILOX: {
+			// the child gets a stream of its own, named by hashing this stream with the number of splits so far
+			const Uint64 stream = (Uint64)state.philox.counter[2] | ((Uint64)state.philox.counter[3] << 32);
+			Uint64 x = stream ^ ((Uint64)++state.philox.splits * 0xd1b54a32d192ed03ull);
+			const Uint64 childStream = splitMix(x);
+			result.state.philox.counter[0] = 0;
+			result.state.philox.counter[1] = 0;
+			result.state.philox.counter[2] = (Uint32)childStream;
+			result.state.philox.counter[3] = (Uint32)(childStream >> 32);
+			result.state.philox.index = 4;
+			result.state.philox.splits = 0;
+			break;
+		}
+		default: {
+			// the child is seeded from this one's output, which this one then never repeats
+			Uint8 seed[32];
+			getBytes(seed, sizeof(seed));
+			result.seedBytes(seed, sizeof(seed));
+			break;
+		}
+	}
+	return result;
+}
+
+Uint8 Random::nextRc4() {
+	Uint8* s = state.rc4.s;
+	Sint32& s_i = state.rc4.i;
+	Sint32& s_j = state.rc4.j;
 	s_i = (s_i + 1) & 255;
 	s_j = (s_j + s[s_i]) & 255;
 	swapByte(s + s_i, s + s_j);
@@ -47,60 +196,148 @@ Uint8 Random::getUint8() {
 	return s[(s[s_i] + s[s_j]) & 255];
 }
 
+Uint64 Random::nextXoshiro() {
+	Uint64* s = state.xoshiro.s;
+	const Uint64 result = rotl(s[1] * 5, 7) * 9;
+	const Uint64 t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
+
+Uint32 Random::nextPhilox() {
+	PhiloxState& p = state.philox;
+	if( p.index >= 4 ) {
+		Uint32 c[4] = { p.counter[0], p.counter[1], p.counter[2], p.counter[3] };
+		Uint32 k[2] = { p.key[0], p.key[1] };
+		for( int round = 0; round < 10; ++round ) {
+			const Uint64 product0 = (Uint64)0xD2511F53u * c[0];
+			const Uint64 product1 = (Uint64)0xCD9E8D57u * c[2];
+			const Uint32 next[4] = {
+				(Uint32)(product1 >> 32) ^ c[1] ^ k[0],
+				(Uint32)product1,
+				(Uint32)(product0 >> 32) ^ c[3] ^ k[1],
+				(Uint32)product0
+			};
+			for( int w = 0; w < 4; ++w ) {
+				c[w] = next[w];
+			}
+			k[0] += 0x9E3779B9u;
+			k[1] += 0xBB67AE85u;
+		}
+		for( int w = 0; w < 4; ++w ) {
+			p.block[w] = c[w];
+		}
+		p.index = 0;
+
+		// only the block half of the counter advances, so streams never overlap
+		if( ++p.counter[0] == 0 ) {
+			++p.counter[1];
+		}
+	}
+	return p.block[p.index++];
+}
+
+Uint8 Random::getUint8() {
+	if( algorithm == Algorithm::RC4 ) {
+		return nextRc4();
+	}
+	return (Uint8)(getUint32() >> 24);
+}
+
 Sint8 Random::getSint8() {
 	return getUint8() & INT8_MAX;
 }
 
 Uint16 Random::getUint16() {
-	Uint16 value;
-	getBytes((Uint8*)&value,sizeof(Uint16));
-	return value;
+	if( algorithm == Algorithm::RC4 ) {
+		Uint16 value;
+		getBytes((Uint8*)&value,sizeof(Uint16));
+		return value;
+	}
+	return (Uint16)(getUint32() >> 16);
 }
 
 Sint16 Random::getSint16() {
-	Sint16 value;
-	getBytes((Uint8*)&value,sizeof(Sint16));
-	return value & INT16_MAX;
+	return getUint16() & INT16_MAX;
 }
 
 Uint32 Random::getUint32() {
-	Uint32 value;
-	getBytes((Uint8*)&value,sizeof(Uint32));
-	return value;
+	switch( algorithm ) {
+		case Algorithm::XOSHIRO:
+			return (Uint32)(nextXoshiro() >> 32);
+		case Algorithm::PHILOX:
+			return nextPhilox();
+		default: {
+			Uint32 value;
+			getBytes((Uint8*)&value,sizeof(Uint32));
+			return value;
+		}
+	}
 }
 
 Sint32 Random::getSint32() {
-	Sint32 value;
-	getBytes((Uint8*)&value,sizeof(Sint32));
-	return value & INT16_MAX;
+	return getUint32() & INT16_MAX;
 }
 
 Uint64 Random::getUint64() {
-	Uint64 value;
-	getBytes((Uint8*)&value,sizeof(Uint64));
-	return value;
+	switch( algorithm ) {
+		case Algorithm::XOSHIRO:
+			return nextXoshiro();
+		case Algorithm::PHILOX: {
+			const Uint64 low = nextPhilox();
+			return low | ((Uint64)nextPhilox() << 32);
+		}
+		default: {
+			Uint64 value;
+			getBytes((Uint8*)&value,sizeof(Uint64));
+			return value;
+		}
+	}
 }
 
 Sint64 Random::getSint64() {
-	Sint64 value;
-	getBytes((Uint8*)&value,sizeof(Sint64));
-	return value & INT16_MAX;
+	return getUint64() & INT16_MAX;
 }
 
 void Random::getBytes(Uint8* buffer, size_t size) {
+	if( algorithm == Algorithm::RC4 ) {
+		while( size>0 ) {
+			*buffer = nextRc4();
+			++buffer;
+			--size;
+		}
+		return;
+	}
 	while( size>0 ) {
-		*buffer = getUint8();
-		++buffer;
-		--size;
+		const Uint64 value = getUint64();
+		const size_t len = std::min(size, sizeof(Uint64));
+		memcpy(buffer, &value, len);
+		buffer += len;
+		size -= len;
 	}
 }
 
 double Random::getDouble() {
-	return getUint32() / (double)(UINT32_MAX);
+	if( algorithm == Algorithm::RC4 ) {
+		return getUint32() / (double)(UINT32_MAX);
+	}
+	return (getUint64() >> 11) * (1.0 / 9007199254740992.0);
 }
 
 float Random::getFloat() {
-	return getUint32() / (float)(UINT32_MAX);
+	if( algorithm == Algorithm::RC4 ) {
+		return getUint32() / (float)(UINT32_MAX);
+	}
+	return (getUint32() >> 8) * (1.f / 16777216.f);
 }
 
 inline void Random::swapByte(Uint8* a, Uint8* b) {
@@ -111,4 +348,4 @@ inline void Random::swapByte(Uint8* a, Uint8* b) {
 
 inline Uint8 Random::getByte(const Uint8* bytes, size_t num, size_t offset) {
 	return bytes[offset % num];
-}
\ No newline at end of file
+}
@@ -6,9 +6,37 @@
 
 class Random {
 public:
+	// the generators a Random can use
+	enum class Algorithm {
+		XOSHIRO,		// xoshiro256**, small and fast (the default)
+		PHILOX,			// Philox4x32-10, counter based, for many parallel streams
+		RC4,			// the original RC4 keystream, to reproduce runs from before the others existed
+		ALGORITHM_MAX
+	};
+
+	// names of the algorithms, for the command line
+	static const char* algorithmNames[(int)Algorithm::ALGORITHM_MAX];
+
 	Random();
+	Random(Algorithm _algorithm);
 	~Random() {}
 
+	// the algorithm new generators use
+	static Algorithm					getDefaultAlgorithm()						{ return defaultAlgorithm; }
+	static void							setDefaultAlgorithm(Algorithm a)			{ defaultAlgorithm = a; }
+
+	// look up an algorithm by name
+	// @param name the name of the algorithm
+	// @param result set to the algorithm, if it was found
+	// @return true if the name matched an algorithm
+	static bool algorithmForName(const char* name, Algorithm& result);
+
+	// getters & setters
+	Algorithm							getAlgorithm() const						{ return algorithm; }
+
+	// switch to another algorithm, which takes effect at the next seed
+	void								setAlgorithm(Algorithm a)					{ algorithm = a; }
+
 	// seed the rng based on the current time
 	void seedTime();
 
@@ -19,6 +47,16 @@ public:
 	// seed the rng based on the given value
 	void seedBytes(const Uint8* seed, size_t size);
 
+	// skip far ahead in the sequence: 2^128 numbers with xoshiro, or to the next stream of 2^64 blocks with philox
+	// the numbers skipped over are never reached again by this generator, so a copy taken before the jump
+	// is an independent stream. RC4 can't jump, so it reseeds itself from its own output instead
+	void jump();
+
+	// split off an independent stream, eg. for another thread. splits can be split again: without limit with philox
+	// and RC4, but only two levels deep with xoshiro (a split of a split of a split asserts)
+	// @return a generator on a stream no other split of this generator or its ancestors uses
+	Random split();
+
 	// @return an unsigned int (8-bit)
 	Uint8 getUint8();
 
@@ -43,10 +81,10 @@ public:
 	// @return a signed long (64-bit)
 	Sint64 getSint64();
 
-	// @return a double (64-bit) (range 0-1, both inclusive)
+	// @return a double (64-bit) (range 0-1, excluding 1 unless using RC4)
 	double getDouble();
 
-	// @return a float (32-bit) (range 0-1, both inclusive)
+	// @return a float (32-bit) (range 0-1, excluding 1 unless using RC4)
 	float getFloat();
 
 	// generate a random value of the given size
@@ -56,9 +94,41 @@ public:
 	void getBytes(Uint8* buffer, size_t size);
 
 private:
-	unsigned char s[256];
-	Sint32 s_i, s_j;
+	static Algorithm defaultAlgorithm;
+
+	struct Rc4State {
+		Uint8 s[256];
+		Sint32 i, j;
+	};
+
+	struct XoshiroState {
+		Uint64 s[4];
+	};
+
+	struct PhiloxState {
+		Uint32 counter[4];	// words 0-1 count blocks, words 2-3 pick the stream
+		Uint32 key[2];
+		Uint32 block[4];	// output of the last block
+		Uint32 index;		// next word of the block to hand out
+		Uint32 splits;		// streams split off so far, to name the next one
+	};
+
+	Algorithm algorithm = Algorithm::XOSHIRO;
+	Uint32 splitDepth = 0; // how many splits this generator is from a seeded one (xoshiro only)
+	union {
+		Rc4State rc4;
+		XoshiroState xoshiro;
+		PhiloxState philox;
+	} state;
 
 	inline void swapByte(Uint8* a, Uint8* b);
 	inline Uint8 getByte(const Uint8* bytes, size_t num, size_t offset);
-};
\ No newline at end of file
+
+	Uint8 nextRc4();
+	Uint64 nextXoshiro();
+
+	// jump xoshiro ahead by the distance the given polynomial encodes
+	// @param polynomial the jump polynomial
+	void jumpXoshiro(const Uint64 (&polynomial)[4]);
+	Uint32 nextPhilox();
+};
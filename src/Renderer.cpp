@@ -574,6 +574,71 @@ void Renderer::drawConsole( const Sint32 height, const char* input, const Linked
 	}
 }
 
+void Renderer::drawProfiler( const Profiler::Summary& summary ) {
+	const int lineHeight = TTF_FontHeight(monoFont);
+	const int lines = 2 + (int)summary.threads.getSize() + (int)summary.rows.getSize();
+
+	// backdrop
+	Rect<int> size;
+	size.x = 0;
+	size.y = 0;
+	size.w = 480;
+	size.h = lines * lineHeight + 10;
+	drawRect(&size, glm::vec4(0.f, 0.f, 0.f, 0.6f));
+
+	Rect<int> pos;
+	pos.x = 5; pos.w = 0;
+	pos.y = 5; pos.h = 0;
+	if( summary.frames == 0 ) {
+		printTextColor(pos, glm::vec4(1.f, 1.f, 0.f, 1.f), "profiling...");
+		return;
+	}
+	StringBuf<64> header("frame: %.2f ms (%u frames)", summary.frameMs, summary.frames);
+	printTextColor(pos, glm::vec4(1.f, 1.f, 0.f, 1.f), header.get());
+	pos.y += lineHeight;
+
+	// busy time per kind of thread
+	for( auto& thread : summary.threads ) {
+		StringBuf<64> line("%s x%.1f: %.2f ms busy", thread.name, thread.count, thread.busyMs);
+		printTextColor(pos, glm::vec4(0.f, 1.f, 1.f, 1.f), line.get());
+		pos.y += lineHeight;
+	}
+	pos.y += lineHeight;
+
+	// every scope, indented by how deeply it was nested
+	for( auto& row : summary.rows ) {
+		StringBuf<128> line("%*s%s [%s]: %.2f ms (max %.2f) x%.1f", (int)row.depth * 2, "",
+			row.name, row.thread, row.ms, row.maxMs, row.calls);
+		printTextColor(pos, glm::vec4(1.f), line.get());
+		pos.y += lineHeight;
+	}
+}
+
+void Renderer::drawCounters( const Counters::Summary& summary ) {
+	const int lineHeight = TTF_FontHeight(monoFont);
+	const int width = 320;
+
+	// backdrop
+	Rect<int> size;
+	size.x = xres - width;
+	size.y = 0;
+	size.w = width;
+	size.h = (Counters::COUNTER_MAX + 1) * lineHeight + 10;
+	drawRect(&size, glm::vec4(0.f, 0.f, 0.f, 0.6f));
+
+	Rect<int> pos;
+	pos.x = xres - width + 5; pos.w = 0;
+	pos.y = 5; pos.h = 0;
+	StringBuf<64> header("per frame, over %u frames%s", summary.frames, Counters::isRecording() ? " (recording)" : "");
+	printTextColor(pos, glm::vec4(1.f, 1.f, 0.f, 1.f), header.get());
+	pos.y += lineHeight;
+	for( int c = 0; c < Counters::COUNTER_MAX; ++c ) {
+		StringBuf<64> line("%s: %.1f", Counters::getName((Counters::Counter)c), summary.values[c]);
+		printText(pos, line.get());
+		pos.y += lineHeight;
+	}
+}
+
 void Renderer::drawRect( const Rect<int>* src, const glm::vec4& color ) {
 	Image* image = mainEngine->getImageResource().dataForString("images/system/white.png");
 	if (!image) {
@@ -609,6 +674,7 @@ void Renderer::printTextColor( const Rect<int>& rect, const glm::vec4& color, co
 }
 
 void Renderer::clearBuffers() {
+	PROFILE_SCOPE("Renderer::clearBuffers");
 	glEnable(GL_DEPTH_TEST);
 	glClearColor( 0.f, 0.f, 0.f, 0.f );
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -616,5 +682,6 @@ void Renderer::clearBuffers() {
 }
 
 void Renderer::swapWindow() {
+	PROFILE_SCOPE("Renderer::swapWindow");
 	SDL_GL_SwapWindow(window);
 }
@@ -6,6 +6,8 @@
 #include "Rect.hpp"
 #include "Engine.hpp"
 #include "Camera.hpp"
+#include "Profiler.hpp"
+#include "Counters.hpp"
 
 class Image;
 
@@ -67,6 +69,14 @@ public:
 	// draws the command console at the given screenheight (0=top)
 	void drawConsole( const Sint32 height, const char* input, const LinkedList<Engine::logmsg_t>& log, const Node<Engine::logmsg_t>* logStart );
 
+	// draws the profiler overlay in the top-left corner of the screen
+	// @param summary the timing to show
+	void drawProfiler( const Profiler::Summary& summary );
+
+	// draws the counters overlay in the top-right corner of the screen
+	// @param summary the counters to show
+	void drawCounters( const Counters::Summary& summary );
+
 	// draw a raised frame for windows or buttons, etc.
 	// @param src the size and coordinates of the frame
 	// @param frameSize the size of the frame border in pixels
@@ -5,6 +5,9 @@
 
 #include "Asset.hpp"
 #include "Map.hpp"
+#include "Profiler.hpp"
+#include "Counters.hpp"
+#include "Allocations.hpp"
 
 template <typename T> class Resource {
 public:
@@ -37,10 +40,14 @@ public:
 
 		T** data = cache.find(name);
 		if( data ) {
+			Counters::add(Counters::RESOURCE_HITS);
 			error = 0;
 			return *data;
 		} else {
 			// data not found, attempt to load it
+			PROFILE_SCOPE("Resource::load");
+			Counters::add(Counters::RESOURCE_MISSES);
+			ALLOC_SCOPE(TAG_IO);
 			T* data = new T(name);
 			Asset* base = data; // enforce Asset base class
 			if( base->isLoaded() ) {
@@ -0,0 +1,89 @@
+// RingQueue.hpp
+// Bounded queue that any number of threads can push to and pop from without locking
+
+#pragma once
+
+#include "Main.hpp"
+
+#include <atomic>
+
+// a fixed ring of slots, each with a sequence number saying whose turn it is to use it.
+// items are filled in and consumed in place, so pushing never allocates or copies more than the caller does
+template <typename T, size_t Capacity>
+class RingQueue {
+public:
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	RingQueue() {
+		for (size_t c = 0; c < Capacity; ++c) {
+			slots[c].sequence.store(c, std::memory_order_relaxed);
+		}
+	}
+
+	RingQueue(const RingQueue&) = delete;
+	RingQueue& operator=(const RingQueue&) = delete;
+
+	// @return true if nothing is waiting to be popped (may be out of date by the time it returns)
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	// claim a slot and fill it in
+	// @param fill called with the item in the slot to fill it in
+	// @return false if the queue is full
+	template <typename Fn>
+	bool push(Fn fill) {
+		size_t pos = head.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[pos & (Capacity - 1)];
+			const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const intptr_t dif = (intptr_t)sequence - (intptr_t)pos;
+			if (dif == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					fill(slot.item);
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (dif < 0) {
+				return false;
+			} else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// take the oldest item, if there is one
+	// @param consume called with the item before its slot is handed back
+	// @return false if the queue is empty
+	template <typename Fn>
+	bool pop(Fn consume) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[pos & (Capacity - 1)];
+			const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			const intptr_t dif = (intptr_t)sequence - (intptr_t)(pos + 1);
+			if (dif == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					consume(slot.item);
+					slot.sequence.store(pos + Capacity, std::memory_order_release);
+					return true;
+				}
+			} else if (dif < 0) {
+				return false;
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	// producers and consumers each get their own cache line
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+	alignas(64) Slot slots[Capacity];
+};
@@ -0,0 +1,527 @@
+// Sensor.cpp
+
+#include "Main.hpp"
+#include "Sensor.hpp"
+#include "Engine.hpp"
+#include "Game.hpp"
+#include "File.hpp"
+
+#include <xmmintrin.h>
+
+// distance along a ray to the first circle it enters, or FLT_MAX if it misses them all
+// circles centered behind the origin are ignored, even if the origin is inside them
+// @param count the number of circles, must be a multiple of four
+// @param index set to the index of the circle hit, or -1
+static float nearestCircle(const float* cx, const float* cy, const float* r2, size_t count, float ox, float oy, float dx, float dy, Sint32& index) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 none = _mm_set1_ps(FLT_MAX);
+	const __m128 sign = _mm_set1_ps(-0.f);
+	const __m128 vox = _mm_set1_ps(ox);
+	const __m128 voy = _mm_set1_ps(oy);
+	const __m128 vdx = _mm_set1_ps(dx);
+	const __m128 vdy = _mm_set1_ps(dy);
+	const __m128 four = _mm_set1_ps(4.f);
+	__m128 lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+	__m128 best = none;
+	__m128 bestLanes = _mm_set1_ps(-1.f);
+
+	for (size_t c = 0; c < count; c += 4) {
+		__m128 acx = _mm_sub_ps(_mm_loadu_ps(cx + c), vox);
+		__m128 acy = _mm_sub_ps(_mm_loadu_ps(cy + c), voy);
+		__m128 rr = _mm_loadu_ps(r2 + c);
+
+		// distance to the point on the ray closest to the center, and how far that point is from the center
+		__m128 p = _mm_add_ps(_mm_mul_ps(acx, vdx), _mm_mul_ps(acy, vdy));
+		__m128 px = _mm_sub_ps(acx, _mm_mul_ps(p, vdx));
+		__m128 py = _mm_sub_ps(acy, _mm_mul_ps(p, vdy));
+		__m128 d2 = _mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py));
+
+		// back up by half the chord to find the entry point
+		__m128 chord = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(rr, d2), zero));
+		__m128 dist = _mm_andnot_ps(sign, _mm_sub_ps(p, chord));
+
+		__m128 hit = _mm_and_ps(_mm_cmpge_ps(p, zero), _mm_cmple_ps(d2, rr));
+		dist = _mm_or_ps(_mm_and_ps(hit, dist), _mm_andnot_ps(hit, none));
+
+		__m128 closer = _mm_cmplt_ps(dist, best);
+		best = _mm_min_ps(best, dist);
+		bestLanes = _mm_or_ps(_mm_and_ps(closer, lanes), _mm_andnot_ps(closer, bestLanes));
+		lanes = _mm_add_ps(lanes, four);
+	}
+
+	// pick the closest of the four lanes
+	float dists[4], indices[4];
+	_mm_storeu_ps(dists, best);
+	_mm_storeu_ps(indices, bestLanes);
+	int lane = 0;
+	for (int c = 1; c < 4; ++c) {
+		if (dists[c] < dists[lane]) {
+			lane = c;
+		}
+	}
+	index = (Sint32)indices[lane];
+	return dists[lane];
+}
+
+// polynomial atan2, accurate to about 1e-5 radians
+static float fastAtan2(float y, float x) {
+	float ax = fabsf(x);
+	float ay = fabsf(y);
+	float a = std::min(ax, ay) / std::max(std::max(ax, ay), FLT_MIN);
+	float s = a * a;
+	float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+	if (ay > ax) {
+		r = PI / 2.f - r;
+	}
+	if (x < 0.f) {
+		r = PI - r;
+	}
+	return y < 0.f ? -r : r;
+}
+
+// scalar version of nearestCircle() for a single circle
+static float circleEntry(float cx, float cy, float r2, float ox, float oy, float dx, float dy) {
+	float acx = cx - ox;
+	float acy = cy - oy;
+	float p = acx * dx + acy * dy;
+	float px = acx - p * dx;
+	float py = acy - p * dy;
+	float d2 = px * px + py * py;
+	if (p < 0.f || d2 > r2) {
+		return FLT_MAX;
+	}
+	return fabsf(p - sqrtf(std::max(r2 - d2, 0.f)));
+}
+
+const int RayFan::binnedRays = 64;
+
+RayFan::RayFan() {
+	setRays(16);
+}
+
+RayFan::RayFan(int rays) {
+	setRays(rays);
+}
+
+void RayFan::setRays(int rays) {
+	assert(rays > 0);
+	baseX.resize(rays);
+	baseY.resize(rays);
+	dirX.resize(rays);
+	dirY.resize(rays);
+	distances.resize(rays);
+	hits.resize(rays);
+	for (int c = 0; c < rays; ++c) {
+		float angle = (PI * 2.f) * (float)c / (float)rays;
+		baseX[c] = cosf(angle);
+		baseY[c] = sinf(angle);
+	}
+}
+
+const ArrayList<float>& RayFan::cast(const Entity& entity) {
+	assert(entity.game);
+	gather(entity);
+	if (mode == Mode::ANGULAR_BINS) {
+		castBinned(entity);
+	} else {
+		castDirect(entity);
+	}
+	return distances;
+}
+
+void RayFan::gather(const Entity& entity) {
+	const Game* game = entity.game;
+
+	obstacles.resize(0);
+	circleX.resize(0);
+	circleY.resize(0);
+	circleR2.resize(0);
+	for (int t = (int)Entity::Team::TEAM_NONE + 1; t < (int)Entity::Team::TEAM_MAX; ++t) {
+		if (t == (int)entity.team) {
+			continue;
+		}
+		for (auto other : game->getEntitiesOfTeam((Entity::Team)t)) {
+			if (other == &entity) {
+				continue;
+			}
+			obstacles.push(other);
+			circleX.push(other->pos.x);
+			circleY.push(other->pos.y);
+			circleR2.push(other->radius * other->radius);
+		}
+	}
+	circles = circleR2.getSize();
+	while (circleR2.getSize() % 4) {
+		circleX.push(0.f);
+		circleY.push(0.f);
+		circleR2.push(-1.f); // never hit
+	}
+}
+
+void RayFan::castDirect(const Entity& entity) {
+	const Game* game = entity.game;
+
+	// rotate the fan to face the same way as the entity
+	const float ca = cosf(entity.ang);
+	const float sa = sinf(entity.ang);
+
+	for (size_t c = 0; c < distances.getSize(); ++c) {
+		const Vector dir(baseX[c] * ca - baseY[c] * sa, baseX[c] * sa + baseY[c] * ca, 0.f);
+		dirX[c] = dir.x;
+		dirY[c] = dir.y;
+		Vector origin = entity.pos;
+		float travelled = 0.f;
+		distances[c] = FLT_MAX;
+		hits[c] = -1;
+		for (int interval = 0; interval <= Entity::maxRayWraps; ++interval) {
+			float dist = nearestCircle(circleX.getArray(), circleY.getArray(), circleR2.getArray(), circleR2.getSize(),
+				origin.x, origin.y, dir.x, dir.y, hits[c]);
+			if (dist < FLT_MAX) {
+				distances[c] = dist + travelled;
+				break;
+			}
+			travelled += game->wrapRay(origin, dir);
+		}
+	}
+}
+
+void RayFan::castBinned(const Entity& entity) {
+	const Game* game = entity.game;
+	const Sint32 rays = (Sint32)distances.getSize();
+	const float step = (PI * 2.f) / (float)rays;
+	const float slack = 1e-3f; // widen each span to cover fastAtan2() error and rounding, so no grazing ray is dropped
+
+	// find the span of rays each obstacle covers before the first wrap
+	binStart.resize(rays + 1);
+	for (Sint32 c = 0; c <= rays; ++c) {
+		binStart[c] = 0;
+	}
+	spans.resize(0);
+	for (size_t i = 0; i < circles; ++i) {
+		Span span;
+		span.circle = (Uint32)i;
+
+		float vx = circleX[i] - entity.pos.x;
+		float vy = circleY[i] - entity.pos.y;
+		float d2 = vx * vx + vy * vy;
+		float sine2 = circleR2[i] / d2;
+		if (d2 <= circleR2[i] || sine2 > 0.8f) {
+			// we're inside it or right next to it, so let every ray try it
+			span.firstRay = 0;
+			span.lastRay = rays - 1;
+		} else {
+			// asin(x) <= x / sqrt(1 - x^2), which is tight for the small angles most obstacles subtend
+			float half = sqrtf(sine2 / (1.f - sine2)) + slack;
+			float low = fastAtan2(vy, vx) - half - entity.ang;
+			low -= floorf(low / (PI * 2.f)) * (PI * 2.f);
+			span.firstRay = (Sint32)ceilf(low / step);
+			span.lastRay = std::min((Sint32)floorf((low + half * 2.f) / step), span.firstRay + rays - 1);
+			if (span.lastRay < span.firstRay) {
+				continue;
+			}
+		}
+		for (Sint32 c = span.firstRay; c <= span.lastRay; ++c) {
+			++binStart[c % rays + 1];
+		}
+		spans.push(span);
+	}
+
+	// sort the spans into bins
+	for (Sint32 c = 0; c < rays; ++c) {
+		binStart[c + 1] += binStart[c];
+	}
+	bins.resize(binStart[rays]);
+	for (auto& span : spans) {
+		for (Sint32 c = span.firstRay; c <= span.lastRay; ++c) {
+			bins[binStart[c % rays]++] = span.circle;
+		}
+	}
+	for (Sint32 c = rays; c > 0; --c) {
+		binStart[c] = binStart[c - 1];
+	}
+	binStart[0] = 0;
+
+	// rotate the fan to face the same way as the entity
+	const float ca = cosf(entity.ang);
+	const float sa = sinf(entity.ang);
+
+	for (Sint32 c = 0; c < rays; ++c) {
+		const Vector dir(baseX[c] * ca - baseY[c] * sa, baseX[c] * sa + baseY[c] * ca, 0.f);
+		dirX[c] = dir.x;
+		dirY[c] = dir.y;
+		distances[c] = FLT_MAX;
+		hits[c] = -1;
+		for (Uint32 b = binStart[c]; b < binStart[c + 1]; ++b) {
+			const Uint32 i = bins[b];
+			float dist = circleEntry(circleX[i], circleY[i], circleR2[i], entity.pos.x, entity.pos.y, dir.x, dir.y);
+			if (dist < distances[c]) {
+				distances[c] = dist;
+				hits[c] = (Sint32)i;
+			}
+		}
+		if (distances[c] < FLT_MAX) {
+			continue;
+		}
+
+		// rays that leave the board without hitting anything fall back to testing everything
+		Vector origin = entity.pos;
+		float travelled = game->wrapRay(origin, dir);
+		for (int interval = 1; interval <= Entity::maxRayWraps; ++interval) {
+			float dist = nearestCircle(circleX.getArray(), circleY.getArray(), circleR2.getArray(), circleR2.getSize(),
+				origin.x, origin.y, dir.x, dir.y, hits[c]);
+			if (dist < FLT_MAX) {
+				distances[c] = dist + travelled;
+				break;
+			}
+			travelled += game->wrapRay(origin, dir);
+		}
+	}
+}
+
+const char* SensorChannel::typeNames[(int)Type::TYPE_MAX] = {
+	"rayDistance",
+	"closingVelocity",
+	"ownVelocity",
+	"shotReady",
+	"nearestEnemy"
+};
+
+int SensorChannel::getInputSize() const {
+	switch (type) {
+	case Type::RAY_DISTANCE:
+	case Type::CLOSING_VELOCITY:
+		return rays;
+	case Type::OWN_VELOCITY:
+	case Type::NEAREST_ENEMY:
+		return 2;
+	case Type::SHOT_READY:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+void SensorChannel::serialize(FileInterface* file) {
+	String name(typeNames[(int)type]);
+	file->property("type", name);
+	if (file->isReading()) {
+		int index = 0;
+		for (; index < (int)Type::TYPE_MAX; ++index) {
+			if (name == typeNames[index]) {
+				break;
+			}
+		}
+		if (index == (int)Type::TYPE_MAX) {
+			mainEngine->fmsg(Engine::MSG_ERROR, "unknown sensor channel type '%s'", name.get());
+		}
+		type = (Type)index; // TYPE_MAX if unknown, which makes the suite invalid
+	}
+	file->property("rays", rays);
+	file->property("near", clipNear);
+	file->property("far", clipFar);
+	if (file->isReading()) {
+		rays = std::max(rays, 1);
+		clipFar = std::max(clipFar, 1.f);
+	}
+}
+
+SensorSuite::SensorSuite() {
+	setDefault();
+}
+
+void SensorSuite::setDefault() {
+	channels.clear();
+	channels.push(SensorChannel());
+	rebuild();
+}
+
+bool SensorSuite::load(const char* filename) {
+	SensorSuite suite;
+	if (!FileHelper::readObject(filename, suite)) {
+		return false;
+	}
+	if (!suite.isValid()) {
+		mainEngine->fmsg(Engine::MSG_ERROR, "sensor config '%s' has unknown channels or no inputs", filename);
+		return false;
+	}
+	*this = suite;
+	return true;
+}
+
+bool SensorSuite::isValid() const {
+	for (auto& channel : channels) {
+		if (channel.type == SensorChannel::Type::TYPE_MAX) {
+			return false;
+		}
+	}
+	return inputSize > 0;
+}
+
+bool SensorSuite::hasSameInputs(const SensorSuite& other) const {
+	if (channels.getSize() != other.channels.getSize()) {
+		return false;
+	}
+	for (Uint32 c = 0; c < channels.getSize(); ++c) {
+		const SensorChannel& a = channels[c];
+		const SensorChannel& b = other.channels[c];
+		if (a.type != b.type || a.rays != b.rays || a.clipNear != b.clipNear || a.clipFar != b.clipFar) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void SensorSuite::serialize(FileInterface* file) {
+	int version = 0;
+	file->property("SensorSuite::version", version);
+	file->property("channels", channels);
+	if (file->isReading()) {
+		rebuild();
+	}
+}
+
+void SensorSuite::rebuild() {
+	inputSize = 0;
+	fans.clear();
+	channelFans.resize(channels.getSize());
+	for (Uint32 c = 0; c < channels.getSize(); ++c) {
+		const SensorChannel& channel = channels[c];
+		inputSize += channel.getInputSize();
+
+		channelFans[c] = -1;
+		if (channel.type != SensorChannel::Type::RAY_DISTANCE &&
+			channel.type != SensorChannel::Type::CLOSING_VELOCITY) {
+			continue;
+		}
+		for (Uint32 f = 0; f < fans.getSize(); ++f) {
+			if (fans[f].getRays() == channel.rays) {
+				channelFans[c] = (Sint32)f;
+				break;
+			}
+		}
+		if (channelFans[c] < 0) {
+			channelFans[c] = (Sint32)fans.getSize();
+			fans.push(RayFan(channel.rays));
+			fans.peek().setMode(channel.rays >= RayFan::binnedRays ? RayFan::Mode::ANGULAR_BINS : RayFan::Mode::DIRECT);
+		}
+	}
+}
+
+void SensorSuite::sense(const Entity& entity, float* inputs) {
+	for (auto& fan : fans) {
+		fan.cast(entity);
+	}
+
+	for (Uint32 c = 0; c < channels.getSize(); ++c) {
+		const SensorChannel& channel = channels[c];
+		switch (channel.type) {
+		case SensorChannel::Type::RAY_DISTANCE:
+			senseRayDistance(channel, fans[channelFans[c]], inputs);
+			break;
+		case SensorChannel::Type::CLOSING_VELOCITY:
+			senseClosingVelocity(entity, fans[channelFans[c]], inputs);
+			break;
+		case SensorChannel::Type::OWN_VELOCITY:
+			senseOwnVelocity(entity, inputs);
+			break;
+		case SensorChannel::Type::SHOT_READY:
+			senseShotReady(entity, inputs);
+			break;
+		case SensorChannel::Type::NEAREST_ENEMY:
+			senseNearestEnemy(channel, entity, inputs);
+			break;
+		default:
+			assert(0);
+			break;
+		}
+		inputs += channel.getInputSize();
+	}
+}
+
+float SensorSuite::getGreatestDanger(const float* inputs) const {
+	float greatestDanger = 0.f;
+	for (auto& channel : channels) {
+		if (channel.type == SensorChannel::Type::RAY_DISTANCE) {
+			for (int c = 0; c < channel.rays; ++c) {
+				greatestDanger = std::max(greatestDanger, inputs[c]);
+			}
+		}
+		inputs += channel.getInputSize();
+	}
+	return greatestDanger;
+}
+
+// map a distance to 1 at clipNear, falling to 0 at clipNear + clipFar
+static float proximity(float distance, float clipNear, float clipFar) {
+	return 1.f - std::min(std::max((distance - clipNear) / clipFar, 0.f), 1.f);
+}
+
+void SensorSuite::senseRayDistance(const SensorChannel& channel, const RayFan& fan, float* inputs) const {
+	for (int c = 0; c < channel.rays; ++c) {
+		inputs[c] = fan.getHit(c) ? proximity(fan.getDistance(c), channel.clipNear, channel.clipFar) : 0.f;
+	}
+}
+
+void SensorSuite::senseClosingVelocity(const Entity& entity, const RayFan& fan, float* inputs) const {
+	for (int c = 0; c < fan.getRays(); ++c) {
+		const Entity* hit = fan.getHit(c);
+		if (hit) {
+			const float closing = -(hit->vel - entity.vel).dot(fan.getDirection(c)) / 10.f;
+			inputs[c] = std::min(std::max(closing, -1.f), 1.f);
+		} else {
+			inputs[c] = 0.f;
+		}
+	}
+}
+
+void SensorSuite::senseOwnVelocity(const Entity& entity, float* inputs) const {
+	const float ca = cosf(entity.ang);
+	const float sa = sinf(entity.ang);
+	inputs[0] = std::min(std::max((entity.vel.x * ca + entity.vel.y * sa) / 10.f, -1.f), 1.f);
+	inputs[1] = std::min(std::max((entity.vel.y * ca - entity.vel.x * sa) / 10.f, -1.f), 1.f);
+}
+
+void SensorSuite::senseShotReady(const Entity& entity, float* inputs) const {
+	if (entity.getType() == Entity::Type::TYPE_PLAYER) {
+		inputs[0] = static_cast<const Player&>(entity).shooting ? 0.f : 1.f;
+	} else {
+		inputs[0] = 0.f;
+	}
+}
+
+void SensorSuite::senseNearestEnemy(const SensorChannel& channel, const Entity& entity, float* inputs) const {
+	const Game* game = entity.game;
+
+	Vector nearest;
+	float nearestDist = FLT_MAX;
+	for (int t = (int)Entity::Team::TEAM_NONE + 1; t < (int)Entity::Team::TEAM_MAX; ++t) {
+		if (t == (int)entity.team) {
+			continue;
+		}
+		for (auto other : game->getEntitiesOfTeam((Entity::Team)t)) {
+			if (other == &entity) {
+				continue;
+			}
+			Vector offset = game->shortestOffset(entity.pos, other->pos);
+			float dist = offset.length() - other->radius;
+			if (dist < nearestDist) {
+				nearestDist = dist;
+				nearest = offset;
+			}
+		}
+	}
+
+	if (nearestDist == FLT_MAX) {
+		inputs[0] = 0.f;
+		inputs[1] = 0.f;
+		return;
+	}
+	float bearing = fmod(atan2f(nearest.y, nearest.x) - entity.ang, PI * 2.f);
+	if (bearing > PI) {
+		bearing -= PI * 2.f;
+	} else if (bearing < -PI) {
+		bearing += PI * 2.f;
+	}
+	inputs[0] = proximity(nearestDist, channel.clipNear, channel.clipFar);
+	inputs[1] = bearing / PI;
+}
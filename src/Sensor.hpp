@@ -0,0 +1,191 @@
+// Sensor.hpp
+
+#pragma once
+
+#include "Main.hpp"
+#include "ArrayList.hpp"
+#include "Vector.hpp"
+
+class Entity;
+class FileInterface;
+
+// casts a fan of evenly spaced rays from an entity all at once
+class RayFan {
+public:
+	RayFan();
+	RayFan(int rays);
+	~RayFan() {}
+
+	// how rays find their obstacles
+	enum class Mode {
+		DIRECT,			// every ray tests every obstacle, four at a time
+		ANGULAR_BINS	// obstacles are first sorted into the rays whose angles they cover, for large fans
+	};
+
+	// @return the current mode
+	Mode getMode() const { return mode; }
+
+	// fans with at least this many rays are usually faster with ANGULAR_BINS
+	static const int binnedRays;
+
+	// set how rays find their obstacles (both give the same results)
+	// @param _mode the new mode
+	void setMode(Mode _mode) { mode = _mode; }
+
+	// set the number of rays, spaced evenly and starting straight ahead
+	// @param rays the number of rays
+	void setRays(int rays);
+
+	// @return the number of rays
+	int getRays() const { return (int)baseX.getSize(); }
+
+	// cast every ray from the given entity, wrapping across the board up to Entity::maxRayWraps times
+	// ray c points along entity.ang + c * 2pi / getRays()
+	// @param entity the entity to cast from, it and its teammates are ignored
+	// @return the distance to the nearest hit along each ray, or FLT_MAX for a miss
+	const ArrayList<float>& cast(const Entity& entity);
+
+	// @param ray the ray index
+	// @return the distance the ray travelled in the last cast, or FLT_MAX for a miss
+	float getDistance(int ray) const { return distances[ray]; }
+
+	// @param ray the ray index
+	// @return the entity the ray hit in the last cast, or nullptr
+	const Entity* getHit(int ray) const { return hits[ray] >= 0 ? obstacles[hits[ray]] : nullptr; }
+
+	// @param ray the ray index
+	// @return the direction the ray was cast in
+	Vector getDirection(int ray) const { return Vector(dirX[ray], dirY[ray], 0.f); }
+
+private:
+	Mode mode = Mode::DIRECT;
+
+	// gather obstacles on opposing teams
+	// @param entity the entity to cast from
+	void gather(const Entity& entity);
+
+	// cast every ray against every obstacle
+	void castDirect(const Entity& entity);
+
+	// cast every ray against just the obstacles in its bin
+	void castBinned(const Entity& entity);
+
+	// ray directions for an entity facing angle zero
+	ArrayList<float> baseX;
+	ArrayList<float> baseY;
+
+	// obstacles gathered for the last cast
+	ArrayList<const Entity*> obstacles;
+
+	// obstacle centers and squared radii, padded to a multiple of four
+	ArrayList<float> circleX;
+	ArrayList<float> circleY;
+	ArrayList<float> circleR2;
+	size_t circles = 0;
+
+	// an obstacle and the rays it covers (which may run past the last ray and wrap around)
+	struct Span {
+		Uint32 circle = 0;
+		Sint32 firstRay = 0;
+		Sint32 lastRay = -1;
+	};
+	ArrayList<Span> spans;
+
+	// obstacle indices grouped by ray, ray c's are in bins[binStart[c]] to bins[binStart[c + 1] - 1]
+	ArrayList<Uint32> bins;
+	ArrayList<Uint32> binStart;
+
+	// results of the last cast
+	ArrayList<float> dirX;
+	ArrayList<float> dirY;
+	ArrayList<float> distances;
+	ArrayList<Sint32> hits;
+};
+
+// one group of network inputs read off an entity
+class SensorChannel {
+public:
+	// what the channel measures
+	enum class Type {
+		RAY_DISTANCE,		// one input per ray, 1 when an obstacle is at clipNear and 0 past clipNear + clipFar or on a miss
+		CLOSING_VELOCITY,	// one input per ray, how fast the obstacle hit is approaching (-1 to 1)
+		OWN_VELOCITY,		// two inputs, forward and sideways speed (-1 to 1)
+		SHOT_READY,			// one input, 1 if the entity can shoot now
+		NEAREST_ENEMY,		// two inputs, clipped distance to the nearest enemy and its bearing (-1 to 1)
+		TYPE_MAX
+	};
+
+	// names used in config files
+	static const char* typeNames[(int)Type::TYPE_MAX];
+
+	Type type = Type::RAY_DISTANCE;
+	Sint32 rays = 16;		// ray channels only
+	float clipNear = 10.f;	// distance channels only
+	float clipFar = 500.f;	// distance channels only, how far past clipNear the input falls to 0 (as the original inputs did)
+
+	// @return the number of inputs this channel produces
+	int getInputSize() const;
+
+	// save/load this object to a file
+	// @param file interface to serialize with
+	void serialize(FileInterface * file);
+};
+
+// a list of sensor channels, producing every network input for an entity in one call
+class SensorSuite {
+public:
+	SensorSuite();
+	~SensorSuite() {}
+
+	// replace the channels with the stock ray distance fan
+	void setDefault();
+
+	// load the channels from a json file
+	// @param filename the file to read
+	// @return true on success, otherwise the suite is left unchanged
+	bool load(const char* filename);
+
+	// @return the total number of inputs produced by every channel
+	int getInputSize() const { return inputSize; }
+
+	// @return true if every channel is of a known type, and there is at least one input
+	bool isValid() const;
+
+	// @param other the suite to compare with
+	// @return true if both suites produce the same inputs in the same order
+	bool hasSameInputs(const SensorSuite& other) const;
+
+	// @return the channels in input order
+	const ArrayList<SensorChannel>& getChannels() const { return channels; }
+
+	// read every channel
+	// @param entity the entity to sense from
+	// @param inputs array of getInputSize() values to fill
+	void sense(const Entity& entity, float* inputs);
+
+	// @param inputs values produced by sense()
+	// @return the largest ray distance input, which is how close the nearest obstacle is
+	float getGreatestDanger(const float* inputs) const;
+
+	// save/load this object to a file
+	// @param file interface to serialize with
+	void serialize(FileInterface * file);
+
+private:
+	ArrayList<SensorChannel> channels;
+	int inputSize = 0;
+
+	// ray channels with the same ray count share a fan, which is cast once per sense()
+	ArrayList<RayFan> fans;
+	ArrayList<Sint32> channelFans;
+
+	// recompute the input size and fans after the channels change
+	void rebuild();
+
+	// channel kernels, each fills the channel's inputs starting at the given pointer
+	void senseRayDistance(const SensorChannel& channel, const RayFan& fan, float* inputs) const;
+	void senseClosingVelocity(const Entity& entity, const RayFan& fan, float* inputs) const;
+	void senseOwnVelocity(const Entity& entity, float* inputs) const;
+	void senseShotReady(const Entity& entity, float* inputs) const;
+	void senseNearestEnemy(const SensorChannel& channel, const Entity& entity, float* inputs) const;
+};
@@ -9,6 +9,7 @@
 #include "Engine.hpp"
 #include "ShaderProgram.hpp"
 #include "Shader.hpp"
+#include "Counters.hpp"
 
 const ShaderProgram* ShaderProgram::currentShader = nullptr;
 
@@ -72,6 +73,7 @@ int ShaderProgram::link() {
 void ShaderProgram::mount() {
 	glUseProgram(programObject);
 	currentShader = this;
+	Counters::add(Counters::SHADER_MOUNTS);
 }
 
 void ShaderProgram::unmount() {
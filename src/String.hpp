@@ -2,9 +2,12 @@
 
 #pragma once
 
+#include "Allocations.hpp"
+
 #undef min
 #undef max
 
+// strings of up to localSize chars (including the terminator) are stored inline, longer ones on the heap
 class String {
 public:
 	String() {
@@ -12,20 +15,26 @@ public:
 	String(const String& src) {
 		assign(src.get());
 	}
+	String(String&& src) {
+		take(src);
+	}
 	String(const char* src) {
 		assign(src);
 	}
-	virtual ~String() {
-		if( str ) {
-			free(str);
-			str = nullptr;
-			size = 0;
+	~String() {
+		if( str && str != local ) {
+			Allocations::release(str);
 		}
+		str = nullptr;
+		size = 0;
 	}
 
 	// represents an invalid position in the string
 	static const size_t npos = UINT32_MAX;
 
+	// the number of chars stored without a heap allocation
+	static const size_t localSize = 16;
+
 	// getters & setters
 	const char* const		get() const			{ return str ? str : ""; }
 	const size_t			getSize() const		{ return size; }
@@ -35,12 +44,14 @@ public:
 	// @return the alloc'd string
 	const char* alloc(const size_t newSize) {
 		size = newSize;
-		if( str ) {
-			char* result = (char*) realloc(str, size * sizeof(char));
+		if( str && str != local ) {
+			char* result = (char*) Allocations::reallocate(str, size * sizeof(char));
 			assert(result);
 			str = result;
+		} else if( size <= localSize ) {
+			str = local;
 		} else {
-			str = (char*) malloc(size * sizeof(char));
+			str = (char*) Allocations::allocate(size * sizeof(char));
 			assert(str);
 		}
 		str[0] = '\0';
@@ -149,7 +160,7 @@ public:
 			return str;
 		}
 
-		char* buf = (char*) malloc( (size-len) * sizeof(char));
+		char* buf = (char*) Allocations::allocate( (size-len) * sizeof(char));
 		assert(buf);
 		buf[0] = '\0';
 		buf[size-len-1] = '\0';
@@ -161,7 +172,7 @@ public:
 
 		strncpy_s((char *)(str + len), size-len-1, buf, size-len-1);
 		str[size-1] = '\0';
-		free(buf);
+		Allocations::release(buf);
 
 		return str;
 	}
@@ -344,6 +355,18 @@ public:
 	const char* operator=(const String& src) {
 		return assign(src.get());
 	}
+	const char* operator=(String&& src) {
+		if( src.str && src.str != src.local && str != src.str ) {
+			if( str && str != local ) {
+				Allocations::release(str);
+			}
+			str = nullptr;
+			size = 0;
+			take(src);
+			return str;
+		}
+		return assign(src.get());
+	}
 
 	// conversion to const char*
 	operator const char*() const {
@@ -353,6 +376,20 @@ public:
 protected:
 	char* str = nullptr;
 	size_t size = 0;
+	char local[localSize];
+
+	// take the contents of another string, which must not own a heap buffer we would leak
+	// @param src the string to empty into this one
+	void take(String& src) {
+		if( src.str && src.str != src.local ) {
+			str = src.str;
+			size = src.size;
+			src.str = nullptr;
+			src.size = 0;
+		} else if( src.str ) {
+			assign(src.str);
+		}
+	}
 };
 
 template<size_t defaultSize>
@@ -365,12 +402,7 @@ public:
 		assign(src.get());
 	}
 	StringBuf(const char* src, ...) {
-		size = defaultSize;
-		str = (char*) malloc( size * sizeof(char) );
-		assert(str);
-
-		str[0] = '\0';
-		str[size-1] = '\0';
+		alloc(defaultSize);
 
 		va_list argptr;
 		va_start( argptr, src );
@@ -379,7 +411,7 @@ public:
 
 		str[size-1] = '\0';
 	}
-	virtual ~StringBuf() {
+	~StringBuf() {
 	}
 
 	// getters & setters
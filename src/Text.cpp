@@ -10,6 +10,7 @@
 #include "Engine.hpp"
 #include "Renderer.hpp"
 #include "Text.hpp"
+#include "Counters.hpp"
 
 const GLfloat Text::positions[8] {
 	0.f, 0.f,
@@ -127,6 +128,7 @@ Text::Text(const char* _name) : Asset(_name) {
 
 	// unbind vertex array
 	glBindVertexArray(0);
+	Counters::add(Counters::BUFFER_UPLOADS, 4); // the texture and three buffers
 
 	loaded = true;
 }
@@ -185,6 +187,7 @@ void Text::drawColor( Rect<int> src, Rect<int> dest, const glm::vec4& color ) co
 	// bind texture
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, texid);
+	Counters::add(Counters::TEXTURE_BINDS);
 
 	// upload uniform variables
 	glUniformMatrix4fv(shader.getUniformLocation("gView"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
@@ -217,4 +220,6 @@ void Text::drawColor( Rect<int> src, Rect<int> dest, const glm::vec4& color ) co
 	// draw
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
 	glBindVertexArray(0);
+	Counters::add(Counters::BUFFER_UPLOADS, 2);
+	Counters::add(Counters::DRAW_TEXT);
 }
\ No newline at end of file